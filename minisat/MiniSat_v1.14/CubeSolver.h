@@ -0,0 +1,68 @@
+/************************************************************************************[CubeSolver.h]
+Cube-and-conquer: the problem of a master solver split into cubes (conjunctions of literals that
+together cover all assignments), each solved as assumptions by one of several threads.
+
+Distributed under the same terms as the rest of MiniSat (see 'LICENSE').
+**************************************************************************************************/
+
+#ifndef CubeSolver_h
+#define CubeSolver_h
+
+#include "Solver.h"
+#include <atomic>
+#include <mutex>
+
+
+//=================================================================================================
+// CubeSolver -- runs several solvers on the cubes of the problem of a master solver:
+
+
+// Each worker has a queue of cubes, a contiguous range of them at first: neighbouring cubes share
+// most of their literals, so what a worker learns on one helps with the next. A worker takes its
+// cubes from the front of its queue; once the queue is empty, it steals the back half of the
+// fullest queue of the others. The learnt clauses of a worker are kept from one cube to the next
+// (they do not depend on the assumptions).
+//
+class CubeSolver {
+    struct Queue {
+        std::mutex  lock;
+        vec<int>    cubes;      // Indices in 'cubes'; those from 'head' on are still to solve.
+        int         head;
+        Queue() : head(0) { }
+        int left() const { return cubes.size() - head; }    // (a hint, without the lock)
+    };
+
+    Solver&             master;     // Takes part as worker 0.
+    vec<Solver*>        workers;
+    vec<Queue*>         queues;     // 'queues[i]' is worker 'i's.
+    const vec<vec<Lit> >* cubes;
+    std::atomic<int>    winner_id;
+    std::atomic<bool>   unsat;      // Some worker found the problem unsatisfiable without assumptions.
+    std::atomic<int>    n_refuted, n_stolen;
+
+    void    configure(Solver& S, int i);
+    int     next     (int i);       // Index of the next cube of worker 'i', stealing if need be (or -1).
+    void    conquer  (int i);       // Solve cubes until one is satisfiable or none is left.
+    void    run      (int i);
+    void    stopAll  ();
+
+public:
+    CubeSolver(Solver& master, int n_threads);
+   ~CubeSolver();
+
+    // Solve the problem of 'master' cube by cube on all threads; the variables of the cubes must not
+    // have been eliminated (freeze them). Afterwards, 'master' holds the result as for 'ParSolver'.
+    // 'l_Undef' if a cube was left undecided (a budget ran out or 'interrupt()' was called) and no
+    // cube was satisfiable. The budgets set on 'master' apply to each worker.
+    lbool   solveLimited(const vec<vec<Lit> >& cubes);
+    void    interrupt();        // Safe to call from any thread (or signal handler).
+
+    int         winner;         // Index of the worker that found a model (or -1).
+    int         refuted;        // Cubes shown unsatisfiable.
+    int         stolen;         // Cubes taken from the queue of another worker.
+    SolverStats stats;          // Statistics summed over all workers.
+};
+
+
+//=================================================================================================
+#endif
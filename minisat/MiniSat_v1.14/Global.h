@@ -107,6 +107,12 @@ static inline double cpuTime(void) {
 static inline int64 memUsed() {
     return 0; }
 
+static inline int64 memPeak() {
+    return 0; }
+
+static inline double wallTime(void) {
+    return (double)time(NULL); }
+
 //- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 #else
 
@@ -119,6 +125,11 @@ static inline double cpuTime(void) {
     getrusage(RUSAGE_SELF, &ru);
     return (double)ru.ru_utime.tv_sec + (double)ru.ru_utime.tv_usec / 1000000; }
 
+static inline double wallTime(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec + (double)tv.tv_usec / 1000000; }
+
 static inline int memReadStat(int field)
 {
     char    name[256];
@@ -135,6 +146,12 @@ static inline int memReadStat(int field)
 
 static inline int64 memUsed() { return (int64)memReadStat(0) * (int64)getpagesize(); }
 
+// Peak resident set size of the process so far (in bytes).
+static inline int64 memPeak() {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (int64)ru.ru_maxrss * 1024; }    // (KB on Linux)
+
 //- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 #endif
 
@@ -174,6 +191,7 @@ public:
 
     // Size operations:
     int      size   (void) const       { return sz; }
+    int      capacity(void) const      { return cap; }
     void     shrink (int nelems)       { assert(nelems <= sz); for (int i = 0; i < nelems; i++) sz--, data[sz].~T(); }
     void     pop    (void)             { sz--, data[sz].~T(); }
     void     growTo (int size);
@@ -69,6 +69,7 @@ class Heap {
     void setBounds (int size) { assert(size >= 0); indices.growTo(size,0); }
     bool inHeap    (int n)    { assert(ok(n)); return indices[n] != 0; }
     void increase  (int n)    { assert(ok(n)); assert(inHeap(n)); percolateUp(indices[n]); }
+    void decrease  (int n)    { assert(ok(n)); assert(inHeap(n)); percolateDown(indices[n]); }
     bool empty     ()         { return heap.size() == 1; }
 
     void insert(int n) {
@@ -96,5 +97,95 @@ class Heap {
 };
 
 
+//=================================================================================================
+// ActivityHeap -- 4-ary max-heap of variables, each entry holding the activity of its variable:
+
+
+// A comparison reads the entries themselves rather than an activity table indexed by variable, and
+// the four children of a node are adjacent (32 bytes with 'float' activities), so sifting down
+// touches one or two cache lines per level over half the levels of a binary heap. The activities
+// in the entries are copies: every change of an activity must be passed on ('increase()',
+// 'update()', 'rekey()').
+//
+template<class A>
+class ActivityHeap {
+  public:
+    struct Entry { A act; int var; };
+    vec<Entry> heap;
+    vec<int>   indices;  // var -> index in heap + 1 (0: not in the heap)
+
+  private:
+    static inline int parent4(int i) { return (i-1) >> 2; }
+    static inline int child4 (int i) { return (i << 2) + 1; }
+
+    inline void percolateUp(int i)
+    {
+        Entry x = heap[i];
+        while (i > 0 && x.act > heap[parent4(i)].act){
+            heap[i]              = heap[parent4(i)];
+            indices[heap[i].var] = i + 1;
+            i                    = parent4(i);
+        }
+        heap   [i]     = x;
+        indices[x.var] = i + 1;
+    }
+
+    inline void percolateDown(int i)
+    {
+        Entry x = heap[i];
+        for (int c; (c = child4(i)) < heap.size();){
+            int best = c, end = c + 4 < heap.size() ? c + 4 : heap.size();
+            for (int k = c + 1; k < end; k++)
+                if (heap[k].act > heap[best].act) best = k;
+            if (!(heap[best].act > x.act)) break;
+            heap[i]              = heap[best];
+            indices[heap[i].var] = i + 1;
+            i                    = best;
+        }
+        heap   [i]     = x;
+        indices[x.var] = i + 1;
+    }
+
+    bool ok(int n) { return n >= 0 && n < (int)indices.size(); }
+
+  public:
+    void setBounds (int size)      { assert(size >= 0); indices.growTo(size,0); }
+    bool inHeap    (int n)         { assert(ok(n)); return indices[n] != 0; }
+    void increase  (int n, A act)  { assert(inHeap(n)); assert(act >= heap[indices[n]-1].act); heap[indices[n]-1].act = act; percolateUp(indices[n]-1); }
+    void update    (int n, A act)  { assert(inHeap(n)); heap[indices[n]-1].act = act; percolateUp(indices[n]-1); percolateDown(indices[n]-1); }
+    bool empty     ()              { return heap.size() == 0; }
+
+    void insert(int n, A act) {
+        assert(ok(n)); assert(!inHeap(n));
+        Entry e; e.act = act; e.var = n;
+        heap.push(e);
+        percolateUp(heap.size()-1); }
+
+    int  getmin() {     // (the variable of largest activity: the top of the max-heap)
+        int r      = heap[0].var;
+        indices[r] = 0;
+        if (heap.size() > 1){
+            heap[0] = heap.last();
+            heap.pop();
+            percolateDown(0);
+        }else
+            heap.pop();
+        return r; }
+
+    // Copy 'act[x]' into the entry of every variable 'x' in the heap. For a change that keeps the order
+    // of the activities (rescaling): no entry moves.
+    template<class V>
+    void rekey(const V& act) {
+        for (int i = 0; i < heap.size(); i++) heap[i].act = act[heap[i].var]; }
+
+    int64 bytes() const { return (int64)heap.capacity() * sizeof(Entry) + (int64)indices.capacity() * sizeof(int); }
+
+    bool heapProperty() {
+        for (int i = 1; i < heap.size(); i++)
+            if (heap[i].act > heap[parent4(i)].act) return false;
+        return true; }
+};
+
+
 //=================================================================================================
 #endif
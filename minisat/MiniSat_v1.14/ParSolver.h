@@ -0,0 +1,81 @@
+/*************************************************************************************[ParSolver.h]
+Portfolio of diversified MiniSat solvers running in parallel on one problem, sharing short and
+low-LBD learnt clauses.
+
+Distributed under the same terms as the rest of MiniSat (see 'LICENSE').
+**************************************************************************************************/
+
+#ifndef ParSolver_h
+#define ParSolver_h
+
+#include "Solver.h"
+#include <atomic>
+
+
+//=================================================================================================
+// ExportBuffer -- lock-free ring of learnt clauses with one writer and any number of readers:
+
+
+// Clauses are stored as '[size, lbd, lit indices...]' in a ring of words. Only the owning thread
+// writes; it never waits for readers. Each reader keeps its own position ('tail') and drops what
+// was overwritten before it got around to read it, or may be being overwritten: the writer stores
+// a clause before it moves 'head' past it, so up to 'maxWrite()' words beyond 'head' may be changing.
+//
+// Memory order (seqlock): 'push()' stores 'head' with release after the words of its clause, and
+// a release fence before them. 'read()' loads 'head' with acquire before the words it reads, so it
+// sees them complete up to that 'head'; after them, an acquire fence then a second 'head' load.
+// If a word it read was stored by a later push, that push's release fence pairs with the acquire
+// fence, so the second 'head' is at least where the push started and the overlap is detected.
+//
+class ExportBuffer {
+    std::atomic<int>*   data;
+    int64               mask;       // (capacity - 1, capacity is a power of 2)
+    std::atomic<int64>  head;       // Number of words written so far.
+
+    int64   maxWrite() const { return (mask+1) / 4; }   // Words of the largest clause pushed (size and LBD included).
+
+public:
+    ExportBuffer(int log_cap = 18) : mask((1LL << log_cap) - 1), head(0) {
+        data = new std::atomic<int>[mask+1]; }
+   ~ExportBuffer() { delete [] data; }
+
+    void push(const vec<Lit>& c, int lbd);                     // (owner only)
+    int  read(int64& tail, vec<Lit>& lits, vec<int>& sizes);   // Returns number of clauses read.
+};
+
+
+//=================================================================================================
+// ParSolver -- runs several solvers on the problem of a master solver:
+
+
+class ParSolver {
+    class Link;
+
+    Solver&             master;     // Takes part as worker 0.
+    vec<Solver*>        workers;
+    vec<Link*>          links;
+    vec<ExportBuffer*>  buffers;    // 'buffers[i]' is written by worker 'i'.
+    std::atomic<bool>   stop_flag;
+    std::atomic<int>    winner_id;
+
+    void    diversify(Solver& S, int i);
+    void    run      (int i);
+
+public:
+    ParSolver(Solver& master, int n_threads);
+   ~ParSolver();
+
+    // Solve the problem of 'master' on all threads. Afterwards, 'master' holds the result of the
+    // first solver to finish ('master.model' if satisfiable, 'master.okay()' is FALSE if not).
+    // The budgets set on 'master' apply to each worker; 'l_Undef' if all of them gave up.
+    lbool   solveLimited();
+    bool    solve() { return solveLimited() == l_True; }
+    void    interrupt() { stop_flag = true; }   // Safe to call from any thread (or signal handler).
+
+    int         winner;         // Index of the worker that finished first (or -1).
+    SolverStats stats;          // Statistics summed over all workers.
+};
+
+
+//=================================================================================================
+#endif
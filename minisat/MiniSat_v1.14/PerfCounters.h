@@ -0,0 +1,134 @@
+/**********************************************************************************[PerfCounters.h]
+Optional hardware performance counters ('perf_event_open()' on Linux) accumulated per code region.
+
+Self-contained (no MiniSat types) so that the Sudoku front end can use it as well.
+
+Distributed under the same terms as the rest of MiniSat (see 'LICENSE').
+**************************************************************************************************/
+
+#ifndef PerfCounters_h
+#define PerfCounters_h
+
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+//=================================================================================================
+// PerfCounters -- one group of counters for the calling thread:
+
+
+// Task clock (always available where 'perf_event_open()' is), then the hardware events. Any of the
+// hardware events may be unavailable (virtual machines, containers, 'perf_event_paranoid').
+//
+enum { perf_task_clock, perf_cycles, perf_instructions, perf_llc_misses, perf_branch_misses, perf_n_events };
+
+class PerfCounters {
+    int     fd    [perf_n_events];    // -1 if not available.
+    int     n_open;
+    int     slot  [perf_n_events];    // Position of each event in what 'read()' returns on the group.
+
+public:
+    PerfCounters() : n_open(0) {
+        for (int i = 0; i < perf_n_events; i++) fd[i] = slot[i] = -1;
+#ifdef __linux__
+        static const uint32_t types  [perf_n_events] = { PERF_TYPE_SOFTWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE };
+        static const uint64_t configs[perf_n_events] = { PERF_COUNT_SW_TASK_CLOCK, PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+        for (int i = 0; i < perf_n_events; i++){
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size           = sizeof(attr);
+            attr.type           = types[i];
+            attr.config         = configs[i];
+            attr.disabled       = (n_open == 0);        // (the group is started by its leader)
+            attr.exclude_kernel = 1;
+            attr.exclude_hv     = 1;
+            attr.read_format    = PERF_FORMAT_GROUP;
+            fd[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, n_open == 0 ? -1 : fd[leader()], 0);
+            if (fd[i] != -1) slot[i] = n_open++;
+        }
+        if (n_open > 0){
+            ioctl(fd[leader()], PERF_EVENT_IOC_RESET,  PERF_IOC_FLAG_GROUP);
+            ioctl(fd[leader()], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP); }
+#endif
+    }
+
+   ~PerfCounters() {
+#ifdef __linux__
+        for (int i = perf_n_events-1; i >= 0; i--) if (fd[i] != -1) close(fd[i]);
+#endif
+    }
+
+    int  leader   () const { for (int i = 0; i < perf_n_events; i++) if (fd[i] != -1) return i; return -1; }
+    bool available() const { return n_open > 0; }
+    bool has      (int event) const { return fd[event] != -1; }
+
+    // Current value of all counters of the group (zero for events not available):
+    void read(uint64_t* vals) const {
+        uint64_t buf[1 + perf_n_events];
+        memset(vals, 0, perf_n_events * sizeof(uint64_t));
+#ifdef __linux__
+        if (n_open == 0 || ::read(fd[leader()], buf, sizeof(buf)) <= 0) return;
+        for (int i = 0; i < perf_n_events; i++)
+            if (slot[i] != -1) vals[i] = buf[1 + slot[i]];
+#endif
+    }
+};
+
+
+//=================================================================================================
+// PerfRegion -- totals for one function or phase; PerfScope -- adds the counts of its lifetime:
+
+
+struct PerfRegion {
+    const char* name;
+    uint64_t    calls;
+    uint64_t    vals[perf_n_events];
+
+    PerfRegion(const char* n) : name(n), calls(0) { memset(vals, 0, sizeof(vals)); }
+
+    void add(const PerfRegion& r) {
+        calls += r.calls;
+        for (int i = 0; i < perf_n_events; i++) vals[i] += r.vals[i]; }
+
+    // One line per region: time, then whatever hardware events 'pc' could open.
+    void print(FILE* out, const PerfCounters& pc) const {
+        if (calls == 0) return;
+        fprintf(out, "perf %-17s: %-12llu   %9.3f ms", name, (unsigned long long)calls, vals[perf_task_clock] / 1e6);
+        if (pc.has(perf_cycles))        fprintf(out, "  %.3g cyc", (double)vals[perf_cycles]);
+        if (pc.has(perf_instructions) && vals[perf_cycles] > 0)
+                                        fprintf(out, "  IPC %.2f", (double)vals[perf_instructions] / vals[perf_cycles]);
+        if (pc.has(perf_llc_misses))    fprintf(out, "  %.3g LLC-miss", (double)vals[perf_llc_misses]);
+        if (pc.has(perf_branch_misses)) fprintf(out, "  %.3g br-miss", (double)vals[perf_branch_misses]);
+        fprintf(out, "\n"); }
+};
+
+
+// Costs one pointer test when 'pc' is NULL (counters switched off), two 'read()' system calls
+// otherwise. Nested scopes are inclusive: the outer region also counts what the inner ones do.
+//
+class PerfScope {
+    const PerfCounters* pc;
+    PerfRegion&         r;
+    uint64_t            start[perf_n_events];
+
+public:
+    PerfScope(const PerfCounters* pc_, PerfRegion& r_) : pc(pc_), r(r_) { if (pc != NULL) pc->read(start); }
+   ~PerfScope() {
+        if (pc == NULL) return;
+        uint64_t end[perf_n_events];
+        pc->read(end);
+        r.calls++;
+        for (int i = 0; i < perf_n_events; i++) r.vals[i] += end[i] - start[i]; }
+};
+
+
+//=================================================================================================
+#endif
@@ -22,6 +22,8 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 
 #include "SolverTypes.h"
 #include "VarOrder.h"
+#include "PerfCounters.h"
+#include <atomic>
 
 // Redfine if you want output to go somewhere else:
 #define reportf(format, args...) ( printf(format , ## args), fflush(stdout) )
@@ -34,8 +36,30 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 struct SolverStats {
     int64   starts, decisions, propagations, conflicts;
     int64   clauses_literals, learnts_literals, max_literals, tot_literals;
+    int64   elim_vars, subsumed, strengthened;      // (set by 'eliminate()')
+    double  simp_time;
+    int64   core_learnts, mid_learnts, local_learnts, tot_lbd;
+    int64   exported, imported;                     // (clause sharing, see 'ParSolver.h')
+    int64   clauses_bytes, learnts_bytes, max_learnts_bytes;   // (clauses of 3 or more literals; binary ones live in 'watches')
+    int64   simp_bytes;                             // (clause copies and occurrence lists of 'eliminate()', at their largest)
     SolverStats() : starts(0), decisions(0), propagations(0), conflicts(0)
-      , clauses_literals(0), learnts_literals(0), max_literals(0), tot_literals(0) { }
+      , clauses_literals(0), learnts_literals(0), max_literals(0), tot_literals(0)
+      , elim_vars(0), subsumed(0), strengthened(0), simp_time(0)
+      , core_learnts(0), mid_learnts(0), local_learnts(0), tot_lbd(0)
+      , exported(0), imported(0)
+      , clauses_bytes(0), learnts_bytes(0), max_learnts_bytes(0), simp_bytes(0) { }
+};
+
+
+// Bytes held by each part of a solver (see 'Solver::memoryUsage()'):
+//
+struct SolverMemory {
+    int64   clauses;        // Problem clauses.
+    int64   learnts;        // Learnt clauses.
+    int64   watches;        // Watcher lists, binary clauses included.
+    int64   variables;      // Per-variable arrays (assignment, level, reason, activity, heap...) and the trail.
+    int64   other;          // Clause pointer lists, clauses kept for 'extendModel()', temporaries.
+    int64   total() const { return clauses + learnts + watches + variables + other; }
 };
 
 
@@ -45,6 +69,24 @@ struct SearchParams {
 };
 
 
+struct SimpParams {
+    int     clause_lim;     // Variables are not eliminated if it produces a resolvent longer than this.
+    int     occ_lim;        // Variables occurring more often than this (in both polarities) are not eliminated.
+    SimpParams(int c = 20, int o = 100) : clause_lim(c), occ_lim(o) { }
+};
+
+
+
+// Interface for exchanging learnt clauses with solvers running in parallel (see 'ParSolver.h').
+//
+class Solver;
+class ClauseExchange {
+public:
+    virtual ~ClauseExchange() { }
+    virtual void exportClause (const vec<Lit>& c, int lbd) = 0;   // Called for each short or low-LBD learnt clause.
+    virtual void importClauses(Solver& S)                  = 0;   // Called at decision level 0. Should use 'S.addLearnt()'.
+};
+
 
 class Solver {
 protected:
@@ -57,10 +99,11 @@ protected:
     double              cla_inc;          // Amount to bump next clause with.
     double              cla_decay;        // INVERSE decay factor for clause activity: stores 1/decay.
 
-    vec<double>         activity;         // A heuristic measurement of the activity of a variable.
+    vec<VarActivity>    activity;         // A heuristic measurement of the activity of a variable.
     double              var_inc;          // Amount to bump next variable with.
     double              var_decay;        // INVERSE decay factor for variable activity: stores 1/decay. Use negative value for static variable order.
     VarOrder            order;            // Keeps track of the decision variable order.
+    vec<char>           polarity;         // 'polarity[var]' is the sign of its decision literal: TRUE (the default) branches on 'var' false.
 
     vec<vec<GClause> >  watches;          // 'watches[lit]' is a list of constraints watching 'lit' (will go there if literal becomes true).
     vec<char>           assigns;          // The current assignments (lbool:s stored as char:s).
@@ -73,6 +116,38 @@ protected:
     int                 simpDB_assigns;   // Number of top-level assignments since last execution of 'simplifyDB()'.
     int64               simpDB_props;     // Remaining number of propagations that must be made before next execution of 'simplifyDB()'.
 
+    // Preprocessing state (see 'Simplify.C'):
+    //
+    vec<char>           frozen;           // 'frozen[var]' is TRUE if the variable must be kept by 'eliminate()' (e.g. used in assumptions).
+    vec<char>           eliminated;       // 'eliminated[var]' is TRUE if the variable was removed by 'eliminate()'. Never a decision variable.
+    vec<int>            elimclauses;      // Clauses removed by variable elimination, kept for 'extendModel()'.
+    friend class Simplifier;
+
+    // Literal block distance (LBD) of learnt clauses:
+    //
+    vec<uint>           lbd_seen;         // 'lbd_seen[level]' is set to 'lbd_stamp' when 'level' has been counted.
+    uint                lbd_stamp;
+    friend class ParSolver;
+    friend class CubeSolver;
+    friend class SolverBench;         // (microbenchmarks, see 'Bench.C')
+
+    // Resource limits (see 'solveLimited()'):
+    //
+    int64               conflict_budget;    // Give up when 'stats.conflicts' reaches this (-1 means no limit).
+    int64               propagation_budget; // Give up when 'stats.propagations' reaches this (-1 means no limit).
+    double              deadline;           // Give up when 'wallTime()' reaches this (0 means no limit).
+    bool                timed_out;          // The deadline has passed (the clock is only read every 256 checks).
+    uint                budget_checks;
+    std::atomic<bool>   asynch_interrupt;   // Set by 'interrupt()'.
+
+    // Checkpoints (see 'Checkpoint.C'):
+    //
+    double              search_conflicts;   // Restart and learnt clause limits of the next 'search()' of 'solveLimited()' (saved in checkpoints).
+    double              search_learnts;
+    double              resume_conflicts;   // Set by 'loadCheckpoint()': the limits the next 'solveLimited()' starts from (0: from 'restart_first'
+    double              resume_learnts;     // and a third of the clauses).
+    double              checkpoint_next;    // 'wallTime()' of the next periodic checkpoint (0: not set yet).
+
     // Temporaries (to reduce allocation overhead). Each variable is prefixed by the method in which is used:
     //
     vec<char>           analyze_seen;
@@ -84,6 +159,11 @@ protected:
     vec<Lit>            addBinary_tmp;
     vec<Lit>            addTernary_tmp;
 
+    void        countClause      (Clause* c, int sign) {  // Keep the byte counts of 'stats' as 'c' is added (+1) or freed (-1).
+        int64& bytes = c->learnt() ? stats.learnts_bytes : stats.clauses_bytes;
+        bytes += sign * Clause_bytes(c->size(), c->learnt());
+        if (stats.learnts_bytes > stats.max_learnts_bytes) stats.max_learnts_bytes = stats.learnts_bytes; }
+
     // Main internal methods:
     //
     bool        assume           (Lit p);
@@ -98,13 +178,23 @@ protected:
     void        reduceDB         ();
     Lit         pickBranchLit    (const SearchParams& params);
     lbool       search           (int nof_conflicts, int nof_learnts, const SearchParams& params);
+    bool        withinBudget     ();
     double      progressEstimate ();
+    void        extendModel      ();
+    template<class C>
+    int         computeLBD       (const C& c);
+    void        updateLBD        (Clause* c);
+    void        setTier          (Clause* c, int tier);
+    int64&      tierCount        (int tier) { return tier == tier_core ? stats.core_learnts : tier == tier_mid ? stats.mid_learnts : stats.local_learnts; }
+    void        hashClause       (const vec<Lit>& ps) {     // (FNV-1a over the literal indices, a separator after each clause)
+        for (int i = 0; i < ps.size(); i++) problem_hash = (problem_hash ^ (uint64)index(ps[i])) * 1099511628211ULL;
+        problem_hash = (problem_hash ^ 0xffffffffULL) * 1099511628211ULL; }
 
     // Activity:
     //
     void     varBumpActivity(Lit p) {
         if (var_decay < 0) return;     // (negative decay means static variable order -- don't bump)
-        if ( (activity[var(p)] += var_inc) > 1e100 ) varRescaleActivity();
+        if ( (activity[var(p)] += var_inc) > VAR_ACTIVITY_LIMIT ) varRescaleActivity();
         order.update(var(p)); }
     void     varDecayActivity  () { if (var_decay >= 0) var_inc *= var_decay; }
     void     varRescaleActivity();
@@ -113,7 +203,7 @@ protected:
 
     // Operations on clauses:
     //
-    void     newClause(const vec<Lit>& ps, bool learnt = false);
+    void     newClause(const vec<Lit>& ps, bool learnt = false, int lbd = 0);
     void     claBumpActivity (Clause* c) { if ( (c->activity() += cla_inc) > 1e20 ) claRescaleActivity(); }
     void     remove          (Clause* c, bool just_dealloc = false);
     bool     locked          (const Clause* c) const { GClause r = reason[var((*c)[0])]; return !r.isLit() && r.clause() == c; }
@@ -132,9 +222,39 @@ public:
              , qhead            (0)
              , simpDB_assigns   (0)
              , simpDB_props     (0)
+             , lbd_stamp        (0)
+             , conflict_budget  (-1)
+             , propagation_budget(-1)
+             , deadline         (0)
+             , timed_out        (false)
+             , budget_checks    (0)
+             , asynch_interrupt (false)
+             , search_conflicts (0)
+             , search_learnts   (0)
+             , resume_conflicts (0)
+             , resume_learnts   (0)
+             , checkpoint_next  (0)
              , default_params   (SearchParams(0.95, 0.999, 0.02))
              , expensive_ccmin  (true)
              , verbosity        (0)
+             , lbd_core_lim     (2)
+             , lbd_mid_lim      (6)
+             , restart_first    (100)
+             , restart_inc      (1.5)
+             , exchange         (NULL)
+             , share_max_size   (8)
+             , share_max_lbd    (2)
+             , stop             (NULL)
+             , perf             (NULL)
+             , perf_propagate   ("propagate")
+             , perf_analyze     ("analyze")
+             , perf_reduceDB    ("reduceDB")
+             , perf_simplifyDB  ("simplifyDB")
+             , perf_eliminate   ("eliminate")
+             , problem_hash     (14695981039346656037ULL)
+             , checkpoint_file  (NULL)
+             , checkpoint_every (60)
+             , resume_restarts  (true)
              , progress_estimate(0)
              {
                 vec<Lit> dummy(2,lit_Undef);
@@ -158,16 +278,46 @@ public:
     int     nAssigns() { return trail.size(); }
     int     nClauses() { return clauses.size() + n_bin_clauses; }   // (minor difference from MiniSat without the GClause trick: learnt binary clauses will be counted as original clauses)
     int     nLearnts() { return learnts.size(); }
+    lbool   modelValue(Lit p) const { return sign(p) ? ~model[var(p)] : model[var(p)]; }
 
     // Statistics: (read-only member variable)
     //
     SolverStats     stats;
+    vec<int64>      learnts_bytes_trace;    // 'stats.learnts_bytes' at the start of each restart.
+    SolverMemory    memoryUsage() const;    // Bytes held now, by part (walks all clauses and watcher lists).
 
     // Mode of operation:
     //
     SearchParams    default_params;     // Restart frequency etc.
     bool            expensive_ccmin;    // Controls conflict clause minimization. TRUE by default.
     int             verbosity;          // Verbosity level. 0=silent, 1=some progress report, 2=everything
+    int             lbd_core_lim;       // Learnt clauses with an LBD up to this are never removed.
+    int             lbd_mid_lim;        // Learnt clauses with an LBD up to this are kept while they are in use.
+    double          restart_first;      // Conflicts before the first restart.
+    double          restart_inc;        // Factor by which the restart limit grows.
+    SimpParams      simp_params;        // Limits used by 'eliminate()'.
+    void            setRandomSeed(double seed) { order.setSeed(seed); }    // For random decisions (see 'SearchParams::random_var_freq').
+
+    // Parallel operation:
+    //
+    ClauseExchange*           exchange;         // If non-NULL, learnt clauses are exported to and imported from here.
+    int                       share_max_size;   // Learnt clauses this short are exported...
+    int                       share_max_lbd;    // ...as are clauses with an LBD up to this.
+    const std::atomic<bool>*  stop;             // If non-NULL and set, 'solveLimited()' gives up as soon as possible (as for 'interrupt()').
+
+    // Profiling:
+    //
+    PerfCounters*   perf;               // If non-NULL, counters are read around each of the functions below (counts are inclusive).
+    PerfRegion      perf_propagate, perf_analyze, perf_reduceDB, perf_simplifyDB, perf_eliminate;
+
+    // Checkpoints (see 'Checkpoint.C'):
+    //
+    uint64  problem_hash;               // Of the clauses given to 'addClause()' so far, in order: identifies the problem of a checkpoint.
+    cchar*  checkpoint_file;            // If non-NULL, 'solveLimited()' saves a checkpoint there every 'checkpoint_every' seconds (at a restart).
+    double  checkpoint_every;
+    bool    resume_restarts;            // If FALSE, a loaded checkpoint keeps its learnt clause limit, but restarts begin at 'restart_first' again.
+    bool    saveCheckpoint(cchar* file);    // FALSE if the file could not be written.
+    bool    loadCheckpoint(cchar* file);    // Call after 'eliminate()', before 'solve()'. FALSE if there is none for this problem.
 
     // Problem specification:
     //
@@ -176,14 +326,32 @@ public:
     void    addUnit   (Lit p)               { if (ok) ok = enqueue(p); }
     void    addBinary (Lit p, Lit q)        { addBinary_tmp [0] = p; addBinary_tmp [1] = q; addClause(addBinary_tmp); }
     void    addTernary(Lit p, Lit q, Lit r) { addTernary_tmp[0] = p; addTernary_tmp[1] = q; addTernary_tmp[2] = r; addClause(addTernary_tmp); }
-    void    addClause (const vec<Lit>& ps)  { newClause(ps); }  // (used to be a difference between internal and external method...)
+    void    addClause (const vec<Lit>& ps)  { hashClause(ps); newClause(ps); }
+    void    addLearnt (const vec<Lit>& ps, int lbd);    // Add a clause implied by the problem (e.g. learnt by another solver). Decision level must be 0.
+    void    cloneInto (Solver& S);                      // Copy variables, top-level assignments and problem clauses into the empty solver 'S'.
+    void    setFrozen (Var v, bool b)       { frozen[v] = (char)b; }
+    void    setActivity(Var v, double act)  { activity[v] = act; order.reorder(v); }   // Decision priority before the first conflicts bump it (bumps start at 1).
+    void    setPolarity(Var v, lbool b)     { polarity[v] = (char)(b != l_True); }      // Value tried first when 'v' is decided ('l_Undef': the default, false).
+    bool    isEliminated(Var v) const       { return eliminated[v]; }
 
     // Solving:
     //
     bool    okay() { return ok; }       // FALSE means solver is in an conflicting state (must never be used again!)
     void    simplifyDB();
-    bool    solve(const vec<Lit>& assumps);
+    bool    eliminate (double time_limit = 10); // Preprocess problem clauses (see 'Simplify.C'). Call once, before 'solve()'.
+    bool    solve(const vec<Lit>& assumps) { return solveLimited(assumps) == l_True; }
     bool    solve() { vec<Lit> tmp; return solve(tmp); }
+    lbool   solveLimited(const vec<Lit>& assumps);  // 'l_Undef' if a budget ran out or 'interrupt()' was called (nothing is known then).
+    lbool   solveLimited() { vec<Lit> tmp; return solveLimited(tmp); }
+
+    // Resource limits for 'solveLimited()' (they stay in effect for later calls until changed):
+    //
+    void    setConfBudget(int64 x)         { conflict_budget    = stats.conflicts    + x; }   // At most 'x' more conflicts.
+    void    setPropBudget(int64 x)         { propagation_budget = stats.propagations + x; }   // At most 'x' more propagations.
+    void    setTimeBudget(double seconds)  { deadline = wallTime() + seconds; timed_out = false; }
+    void    budgetOff()                    { conflict_budget = propagation_budget = -1; deadline = 0; timed_out = false; }
+    void    interrupt()                    { asynch_interrupt = true; }    // Safe to call from another thread or a signal handler.
+    void    clearInterrupt()               { asynch_interrupt = false; }
 
     double      progress_estimate;  // Set by 'search()'.
     vec<lbool>  model;              // If problem is satisfiable, this vector contains the model (if any).
@@ -191,6 +359,45 @@ public:
 };
 
 
+//=================================================================================================
+// Implementation of inline methods:
+
+
+inline bool Solver::withinBudget()
+{
+    if (asynch_interrupt.load(std::memory_order_relaxed) || (stop != NULL && stop->load(std::memory_order_relaxed)))
+        return false;
+    if ((conflict_budget >= 0 && stats.conflicts >= conflict_budget) || (propagation_budget >= 0 && stats.propagations >= propagation_budget))
+        return false;
+    if (deadline > 0 && !timed_out && (budget_checks++ & 255) == 0 && wallTime() >= deadline)
+        timed_out = true;
+    return !timed_out;
+}
+
+
+//=================================================================================================
+// Implementation of template methods:
+
+
+// Number of distinct decision levels among the literals of 'c' (all of which must be assigned).
+//
+template<class C>
+int Solver::computeLBD(const C& c)
+{
+    if (++lbd_stamp == 0){
+        for (int i = 0; i < lbd_seen.size(); i++) lbd_seen[i] = 0;
+        lbd_stamp = 1; }
+    int lbd = 0;
+    for (int i = 0; i < c.size(); i++){
+        int l = level[var(c[i])];
+        if (lbd_seen[l] != lbd_stamp)
+            lbd_seen[l] = lbd_stamp,
+            lbd++;
+    }
+    return lbd;
+}
+
+
 //=================================================================================================
 // Debug:
 
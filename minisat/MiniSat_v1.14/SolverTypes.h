@@ -76,6 +76,9 @@ inline int toDimacs(Lit p) { return sign(p) ? -var(p) - 1 : var(p) + 1; }
 // Clause -- a simple class for representing a clause:
 
 
+// Tiers of learnt clauses (see 'Solver::reduceDB()'):
+enum { tier_core = 0, tier_mid = 1, tier_local = 2 };
+
 class Clause {
     uint    size_learnt;
     Lit     data[1];
@@ -84,7 +87,7 @@ public:
     Clause(bool learnt, const vec<Lit>& ps) {
         size_learnt = (ps.size() << 1) | (int)learnt;
         for (int i = 0; i < ps.size(); i++) data[i] = ps[i];
-        if (learnt) activity() = 0; }
+        if (learnt) activity() = 0, meta() = 0; }
 
     // -- use this function instead:
     friend Clause* Clause_new(bool learnt, const vec<Lit>& ps);
@@ -93,12 +96,24 @@ public:
     bool      learnt      ()      const { return size_learnt & 1; }
     Lit       operator [] (int i) const { return data[i]; }
     Lit&      operator [] (int i)       { return data[i]; }
+
+    // Learnt clauses only:
     float&    activity    ()      const { return *((float*)&data[size()]); }
+    uint&     meta        ()      const { return *((uint*) &data[size()+1]); }  // LBD (bits 0-23), tier (bits 24-25), used (bit 26).
+    int       lbd         ()      const { return meta() & 0xffffff; }
+    int       tier        ()      const { return (meta() >> 24) & 3; }
+    bool      used        ()      const { return (meta() >> 26) & 1; }
+    void      setLbd      (int l)       { meta() = (meta() & ~0xffffffu) | (uint)min(l, 0xffffff); }
+    void      setTier     (int t)       { meta() = (meta() & ~(3u << 24)) | ((uint)t << 24); }
+    void      setUsed     (bool u)      { meta() = (meta() & ~(1u << 26)) | ((uint)u << 26); }
 };
+// Bytes allocated for a clause (header, literals, and activity and meta data if learnt):
+inline int Clause_bytes(int size, bool learnt) { return sizeof(Clause) - sizeof(Lit) + sizeof(uint)*(size + 2*(int)learnt); }
+
 inline Clause* Clause_new(bool learnt, const vec<Lit>& ps) {
     assert(sizeof(Lit)      == sizeof(uint));
     assert(sizeof(float)    == sizeof(uint));
-    void*   mem = xmalloc<char>(sizeof(Clause) - sizeof(Lit) + sizeof(uint)*(ps.size() + (int)learnt));
+    void*   mem = xmalloc<char>(Clause_bytes(ps.size(), learnt));
     return new (mem) Clause(learnt, ps); }
 
 
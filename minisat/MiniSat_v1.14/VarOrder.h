@@ -27,48 +27,74 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 //=================================================================================================
 
 
-struct VarOrder_lt {
-    const vec<double>&  activity;
-    bool operator () (Var x, Var y) { return activity[x] > activity[y]; }
-    VarOrder_lt(const vec<double>&  act) : activity(act) { }
-};
+// Variable activities are 'double' unless MiniSat is compiled with 'FLOAT_ACTIVITY' ("make
+// FLOAT_ACTIVITY=1"): 'float' halves the heap entries and the activity table, and activities are
+// then rescaled at 1e20 (as clause activities are) instead of 1e100 to stay within its range.
+// With its 24-bit mantissa, a bump smaller than about 1/1.6e7 of an activity is lost, which
+// changes the decisions; the heap alone gets faster ('heap-4f' in 'Bench.C'), not the solves.
+//
+#ifdef FLOAT_ACTIVITY
+typedef float  VarActivity;
+#define VAR_ACTIVITY_LIMIT 1e20
+#else
+typedef double VarActivity;
+#define VAR_ACTIVITY_LIMIT 1e100
+#endif
+
 
 class VarOrder {
-    const vec<char>&    assigns;     // var->val. Pointer to external assignment table.
-    const vec<double>&  activity;    // var->act. Pointer to external activity table.
-    Heap<VarOrder_lt>   heap;
-    double              random_seed; // For the internal random number generator
+    const vec<char>&          assigns;     // var->val. Pointer to external assignment table.
+    const vec<VarActivity>&   activity;    // var->act. Pointer to external activity table (copied into the heap entries).
+    ActivityHeap<VarActivity> heap;
+    double                    random_seed; // For the internal random number generator
 
 public:
-    VarOrder(const vec<char>& ass, const vec<double>& act) :
-        assigns(ass), activity(act), heap(VarOrder_lt(act)), random_seed(91648253)
+    VarOrder(const vec<char>& ass, const vec<VarActivity>& act) :
+        assigns(ass), activity(act), random_seed(91648253)
         { }
 
     inline void newVar(void);
     inline void update(Var x);                  // Called when variable increased in activity.
+    inline void reorder(Var x);                 // Called when the activity of variable was set to any value.
+    inline void rescaled(void);                 // Called when all activities were multiplied by the same factor.
     inline void undo(Var x);                    // Called when variable is unassigned and may be selected again.
     inline Var  select(double random_freq =.0); // Selects a new, unassigned variable (or 'var_Undef' if none exists).
+    void        setSeed(double seed) { assert(seed != 0); random_seed = seed; }
+    int64       bytes() const { return heap.bytes(); }
 };
 
 
 void VarOrder::newVar(void)
 {
     heap.setBounds(assigns.size());
-    heap.insert(assigns.size()-1);
+    heap.insert(assigns.size()-1, activity.last());
 }
 
 
 void VarOrder::update(Var x)
 {
     if (heap.inHeap(x))
-        heap.increase(x);
+        heap.increase(x, activity[x]);
+}
+
+
+void VarOrder::reorder(Var x)
+{
+    if (heap.inHeap(x))
+        heap.update(x, activity[x]);
+}
+
+
+void VarOrder::rescaled(void)
+{
+    heap.rekey(activity);
 }
 
 
 void VarOrder::undo(Var x)
 {
     if (!heap.inHeap(x))
-        heap.insert(x);
+        heap.insert(x, activity[x]);
 }
 
 
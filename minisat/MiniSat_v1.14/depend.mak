@@ -0,0 +1,56 @@
+Checkpoint.o: Checkpoint.C Solver.h SolverTypes.h Global.h VarOrder.h \
+ Heap.h PerfCounters.h
+CubeSolver.o: CubeSolver.C CubeSolver.h Solver.h SolverTypes.h Global.h \
+ VarOrder.h Heap.h PerfCounters.h
+Main.o: Main.C Solver.h SolverTypes.h Global.h VarOrder.h Heap.h \
+ PerfCounters.h ParSolver.h
+ParSolver.o: ParSolver.C ParSolver.h Solver.h SolverTypes.h Global.h \
+ VarOrder.h Heap.h PerfCounters.h
+Simplify.o: Simplify.C Solver.h SolverTypes.h Global.h VarOrder.h Heap.h \
+ PerfCounters.h Sort.h
+Solver.o: Solver.C Solver.h SolverTypes.h Global.h VarOrder.h Heap.h \
+ PerfCounters.h Sort.h
+Bench.o: Bench.C Solver.h SolverTypes.h Global.h VarOrder.h Heap.h \
+ PerfCounters.h Sort.h
+Checkpoint.op: Checkpoint.C Solver.h SolverTypes.h Global.h VarOrder.h \
+ Heap.h PerfCounters.h
+CubeSolver.op: CubeSolver.C CubeSolver.h Solver.h SolverTypes.h Global.h \
+ VarOrder.h Heap.h PerfCounters.h
+Main.op: Main.C Solver.h SolverTypes.h Global.h VarOrder.h Heap.h \
+ PerfCounters.h ParSolver.h
+ParSolver.op: ParSolver.C ParSolver.h Solver.h SolverTypes.h Global.h \
+ VarOrder.h Heap.h PerfCounters.h
+Simplify.op: Simplify.C Solver.h SolverTypes.h Global.h VarOrder.h Heap.h \
+ PerfCounters.h Sort.h
+Solver.op: Solver.C Solver.h SolverTypes.h Global.h VarOrder.h Heap.h \
+ PerfCounters.h Sort.h
+Bench.op: Bench.C Solver.h SolverTypes.h Global.h VarOrder.h Heap.h \
+ PerfCounters.h Sort.h
+Checkpoint.od: Checkpoint.C Solver.h SolverTypes.h Global.h VarOrder.h \
+ Heap.h PerfCounters.h
+CubeSolver.od: CubeSolver.C CubeSolver.h Solver.h SolverTypes.h Global.h \
+ VarOrder.h Heap.h PerfCounters.h
+Main.od: Main.C Solver.h SolverTypes.h Global.h VarOrder.h Heap.h \
+ PerfCounters.h ParSolver.h
+ParSolver.od: ParSolver.C ParSolver.h Solver.h SolverTypes.h Global.h \
+ VarOrder.h Heap.h PerfCounters.h
+Simplify.od: Simplify.C Solver.h SolverTypes.h Global.h VarOrder.h Heap.h \
+ PerfCounters.h Sort.h
+Solver.od: Solver.C Solver.h SolverTypes.h Global.h VarOrder.h Heap.h \
+ PerfCounters.h Sort.h
+Bench.od: Bench.C Solver.h SolverTypes.h Global.h VarOrder.h Heap.h \
+ PerfCounters.h Sort.h
+Checkpoint.or: Checkpoint.C Solver.h SolverTypes.h Global.h VarOrder.h \
+ Heap.h PerfCounters.h
+CubeSolver.or: CubeSolver.C CubeSolver.h Solver.h SolverTypes.h Global.h \
+ VarOrder.h Heap.h PerfCounters.h
+Main.or: Main.C Solver.h SolverTypes.h Global.h VarOrder.h Heap.h \
+ PerfCounters.h ParSolver.h
+ParSolver.or: ParSolver.C ParSolver.h Solver.h SolverTypes.h Global.h \
+ VarOrder.h Heap.h PerfCounters.h
+Simplify.or: Simplify.C Solver.h SolverTypes.h Global.h VarOrder.h Heap.h \
+ PerfCounters.h Sort.h
+Solver.or: Solver.C Solver.h SolverTypes.h Global.h VarOrder.h Heap.h \
+ PerfCounters.h Sort.h
+Bench.or: Bench.C Solver.h SolverTypes.h Global.h VarOrder.h Heap.h \
+ PerfCounters.h Sort.h
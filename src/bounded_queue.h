@@ -0,0 +1,188 @@
+/**
+ * @file bounded_queue.h
+ * @brief lock-free bounded queue between the stages of the batch pipeline, with occupancy counts.
+ *
+ * any number of producers and consumers (D. Vyukov's bounded MPMC queue): each slot has a sequence
+ * number telling whether it is free for the push of position pos (== pos) or holds the item of
+ * pos (== pos + 1); a push or pop claims its position with one compare-and-swap, no lock.
+ *
+ * push() waits while the queue is full and pop() while it is empty, yielding then sleeping a little
+ * longer each time: a stage waits for seconds when the solver is the slow one. pop() returns false
+ * once every producer has called close() and the queue is empty.
+ *
+ * the counts tell the bottleneck: the queue in front of the slowest stage stays full (its producers
+ * wait), the queues after it stay empty (their consumers wait).
+ */
+
+#ifndef __BOUNDED_QUEUE_H__
+#define __BOUNDED_QUEUE_H__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <ostream>
+#include <thread>
+
+/** @brief wait a little longer each round: yield the first rounds, then sleep up to 1 ms */
+inline void backoff(uint32_t& round){
+    if( round < 16 ){
+        std::this_thread::yield();
+    }
+    else{
+        std::this_thread::sleep_for(std::chrono::microseconds(std::min(1000u, 10u << std::min(round - 16, 7u))));
+    }
+    round++;
+}
+
+template <class T>
+class BoundedQueue {
+public:
+    /** @brief capacity is rounded up to a power of 2; pop() ends after producers calls of close() */
+    BoundedQueue(const char* name, size_t capacity, uint32_t producers = 1)
+        : name(name), producers(producers) {
+        size_t slots = 1;
+        while( slots < capacity ){
+            slots *= 2;
+        }
+        mask = slots - 1;
+        cells.reset(new Cell[slots]);
+        for( size_t i = 0; i < slots; i++ ){
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /** @brief move item in unless the queue is full */
+    bool try_push(T& item){
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while( true ){
+            cell = &cells[pos & mask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if( diff == 0 ){
+                if( enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed) ){
+                    break;
+                }
+            }
+            else if( diff < 0 ){
+                return false;
+            }
+            else{
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(item);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+
+        pushes.fetch_add(1, std::memory_order_relaxed);
+        occupancy_sum.fetch_add(size(), std::memory_order_relaxed);
+        return true;
+    }
+
+    /** @brief move the oldest item out unless the queue is empty */
+    bool try_pop(T& item){
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while( true ){
+            cell = &cells[pos & mask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if( diff == 0 ){
+                if( dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed) ){
+                    break;
+                }
+            }
+            else if( diff < 0 ){
+                return false;
+            }
+            else{
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        item = std::move(cell->data);
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** @brief move item in, waiting while the queue is full */
+    void push(T& item){
+        if( try_push(item) ){
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        for( uint32_t round = 0; !try_push(item); ){
+            backoff(round);
+        }
+        full_waits.fetch_add(1, std::memory_order_relaxed);
+        full_wait_ns.fetch_add(elapsed_ns(start), std::memory_order_relaxed);
+    }
+
+    /** @brief move the oldest item out, waiting while the queue is empty; false once closed and drained */
+    bool pop(T& item){
+        if( try_pop(item) ){
+            return true;
+        }
+        auto start = std::chrono::steady_clock::now();
+        bool popped = true;
+        for( uint32_t round = 0; !try_pop(item); ){
+            // closed after the last push: once seen, one more try gets anything left
+            if( producers.load(std::memory_order_acquire) == 0 ){
+                popped = try_pop(item);
+                break;
+            }
+            backoff(round);
+        }
+        empty_wait_ns.fetch_add(elapsed_ns(start), std::memory_order_relaxed);
+        return popped;
+    }
+
+    /** @brief one producer is done */
+    void close(){
+        producers.fetch_sub(1, std::memory_order_release);
+    }
+
+    size_t capacity() const { return mask + 1; }
+    /** @brief items in the queue, exact only while nobody pushes or pops */
+    size_t size() const {
+        size_t enqueued = enqueue_pos.load(std::memory_order_relaxed);
+        size_t dequeued = dequeue_pos.load(std::memory_order_relaxed);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    /** @brief one line: capacity, mean occupancy seen by the pushes, waits of both sides */
+    void print_stats(std::ostream& out) const {
+        uint64_t push_num = pushes.load();
+        double occupancy = push_num > 0 ? static_cast<double>(occupancy_sum.load()) / push_num : 0;
+        char line[192];
+        std::snprintf(line, sizeof(line), "queue %-8s: capacity %zu, mean occupancy %.1f (%.0f%%), full at %.0f%% of pushes,"
+                      " producers waited %.3f s, consumers waited %.3f s",
+                      name, capacity(), occupancy, 100 * occupancy / capacity(),
+                      push_num > 0 ? 100.0 * full_waits.load() / push_num : 0.0,
+                      full_wait_ns.load() / 1e9, empty_wait_ns.load() / 1e9);
+        out << line << "\n";
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    static uint64_t elapsed_ns(std::chrono::steady_clock::time_point start){
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    const char* name;
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) std::atomic<size_t> enqueue_pos{0};
+    alignas(64) std::atomic<size_t> dequeue_pos{0};
+    alignas(64) std::atomic<uint32_t> producers;
+
+    std::atomic<uint64_t> pushes{0}, occupancy_sum{0}, full_waits{0}, full_wait_ns{0}, empty_wait_ns{0};
+};
+
+#endif /* end of include guard: __BOUNDED_QUEUE_H__ */
@@ -0,0 +1,157 @@
+/**
+ * @file clause_sink.cpp
+ * @brief where generated clauses go: counted, written as DIMACS or BCNF, or fed to a solver.
+ */
+
+#include "clause_sink.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+void CountingSink::add_clause(const int32_t* literals, uint32_t count){
+    for( uint32_t i = 0; i < count; i++ ){
+        uint32_t var = literals[i] > 0 ? literals[i] : -literals[i];
+        if( var > var_num ){
+            var_num = var;
+        }
+    }
+    clause_num++;
+    literal_num += count;
+}
+
+DimacsSink::DimacsSink(std::ostream& out, uint32_t var_num, uint32_t clause_num) : out(out) {
+    out << "p cnf " << var_num << " " << clause_num << "\n";
+}
+
+void DimacsSink::add_clause(const int32_t* literals, uint32_t count){
+    char digits[16];
+    for( uint32_t i = 0; i < count; i++ ){
+        char* end = digits + sizeof(digits);
+        char* p = end;
+        uint32_t value = literals[i] > 0 ? literals[i] : -literals[i];
+        *--p = ' ';
+        do {
+            *--p = '0' + value % 10;
+            value /= 10;
+        } while( value != 0 );
+        if( literals[i] < 0 ){
+            *--p = '-';
+        }
+        buffer.append(p, end);
+    }
+    buffer += "0\n";
+
+    if( buffer.size() >= (1 << 16) ){
+        flush();
+    }
+}
+
+void DimacsSink::flush(){
+    out << buffer;
+    buffer.clear();
+}
+
+BcnfSink::BcnfSink(std::ostream& out, uint32_t var_num, uint32_t clause_num) : out(out) {
+    int32_t header[4] = {0, 0x01020304, static_cast<int32_t>(var_num), static_cast<int32_t>(clause_num)};
+    std::memcpy(header, "BCNF", 4);
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    chunk.reserve(CHUNK_LIMIT);
+}
+
+void BcnfSink::add_clause(const int32_t* literals, uint32_t count){
+    // the clause and the -1 that ends a chunk must fit
+    if( chunk.size() + count + 2 > CHUNK_LIMIT ){
+        flush();
+    }
+    chunk.push_back(count);
+    for( uint32_t i = 0; i < count; i++ ){
+        int32_t literal = literals[i];
+        chunk.push_back(literal > 0 ? 2 * (literal-1) : 2 * (-literal-1) + 1);
+    }
+}
+
+void BcnfSink::flush(){
+    if( chunk.empty() ){
+        return;
+    }
+    chunk.push_back(-1);
+    int32_t length = chunk.size();
+    out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    out.write(reinterpret_cast<const char*>(chunk.data()), chunk.size() * sizeof(int32_t));
+    chunk.clear();
+}
+
+void ClauseBuffer::add_clause(const int32_t* literals, uint32_t count){
+    data.push_back(count);
+    data.insert(data.end(), literals, literals + count);
+}
+
+void ClauseBuffer::replay(ClauseSink& sink) const {
+    for( size_t i = 0; i < data.size(); i += data[i] + 1 ){
+        sink.add_clause(data.data() + i + 1, data[i]);     // (one past the end for a last empty clause)
+    }
+}
+
+void gen_exactly_one(const int32_t* vars, uint32_t count, ClauseSink& sink, uint32_t& aux){
+    // define
+    sink.add_clause(vars, count);
+    // use
+    if( count <= PAIRWISE_MAX ){
+        for( uint32_t i = 0; i < count; i++ ){
+            for( uint32_t j = i+1; j < count; j++ ){
+                sink.add_binary(-vars[i], -vars[j]);
+            }
+        }
+        return;
+    }
+
+    // ladder (sequential counter) encoding: s_i <=> some of x_1..x_i is true,
+    //   x_i => s_i, s_(i-1) => s_i, x_i => !s_(i-1)
+    // 3k-4 clauses and k-1 new variables instead of k(k-1)/2 clauses.
+    int32_t prev = static_cast<int32_t>(aux++);
+    sink.add_binary(-vars[0], prev);
+    for( uint32_t i = 1; i+1 < count; i++ ){
+        int32_t next = static_cast<int32_t>(aux++);
+        sink.add_binary(-vars[i], next);
+        sink.add_binary(-prev, next);
+        sink.add_binary(-vars[i], -prev);
+        prev = next;
+    }
+    sink.add_binary(-vars[count-1], -prev);
+}
+
+void generate_in_order(uint32_t task_num, uint32_t threads, const std::function<void(uint32_t, ClauseSink&)>& gen_task, ClauseSink& sink){
+    if( threads <= 1 ){
+        for( uint32_t task = 0; task < task_num; task++ ){
+            gen_task(task, sink);
+        }
+        return;
+    }
+
+    const uint32_t WINDOW = 4 * threads;
+    std::vector<ClauseBuffer> buffers(WINDOW);
+    for( uint32_t first = 0; first < task_num; first += WINDOW ){
+        uint32_t last = std::min(task_num, first + WINDOW);
+        std::atomic<uint32_t> next(first);
+        auto work = [&](){
+            for( uint32_t task = next++; task < last; task = next++ ){
+                gen_task(task, buffers[task - first]);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for( uint32_t i = 1; i < threads && i < last - first; i++ ){
+            workers.emplace_back(work);
+        }
+        work();
+        for( auto& worker : workers ){
+            worker.join();
+        }
+
+        for( uint32_t task = first; task < last; task++ ){
+            buffers[task - first].replay(sink);
+            buffers[task - first].clear();
+        }
+    }
+}
@@ -0,0 +1,113 @@
+/**
+ * @file clause_sink.h
+ * @brief where generated clauses go: counted, written as DIMACS or BCNF, or fed to a solver.
+ *
+ * clause generation pushes each clause into a sink as soon as it is made, so no list of all the
+ * clauses is ever held. a consumer that needs the totals first (the DIMACS and BCNF headers) runs
+ * the generation twice: into a CountingSink, then into the writer.
+ */
+
+#ifndef __CLAUSE_SINK_H__
+#define __CLAUSE_SINK_H__
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class ClauseSink {
+public:
+    virtual ~ClauseSink() {}
+    /** @brief one clause of count DIMACS literals (variable numbers from 1, negative for negated) */
+    virtual void add_clause(const int32_t* literals, uint32_t count) = 0;
+
+    void add_binary(int32_t a, int32_t b){
+        int32_t clause[2] = {a, b};
+        add_clause(clause, 2);
+    }
+};
+
+/** @brief counts only: the header pass */
+class CountingSink : public ClauseSink {
+public:
+    uint32_t var_num = 0;           // largest variable seen
+    uint32_t clause_num = 0;
+    uint64_t literal_num = 0;
+
+    void add_clause(const int32_t* literals, uint32_t count) override;
+};
+
+/** @brief DIMACS CNF text, the header is written first so the totals must be known */
+class DimacsSink : public ClauseSink {
+public:
+    DimacsSink(std::ostream& out, uint32_t var_num, uint32_t clause_num);
+    ~DimacsSink() { flush(); }
+
+    void add_clause(const int32_t* literals, uint32_t count) override;
+    void flush();
+
+private:
+    std::ostream& out;
+    std::string buffer;     // formatted by hand: operator<< per literal is several times slower
+};
+
+/**
+ * @brief MiniSat's binary CNF (read for input files named *.bcnf): "BCNF", 0x01020304, variables,
+ * clauses as 32-bit ints in native byte order, then chunks of [length, {size, literals...}..., -1],
+ * literals as 2 * (variable-1) + negated. no text to format or parse.
+ */
+class BcnfSink : public ClauseSink {
+public:
+    /** @brief ints per chunk, MiniSat's CHUNK_LIMIT */
+    static const uint32_t CHUNK_LIMIT = 1 << 20;
+
+    BcnfSink(std::ostream& out, uint32_t var_num, uint32_t clause_num);
+    ~BcnfSink() { flush(); }
+
+    void add_clause(const int32_t* literals, uint32_t count) override;
+    void flush();
+
+private:
+    std::ostream& out;
+    std::vector<int32_t> chunk;
+};
+
+/** @brief the clauses of one generation task, kept until they can be passed on in order */
+class ClauseBuffer : public ClauseSink {
+public:
+    void add_clause(const int32_t* literals, uint32_t count) override;
+    /** @brief pass the clauses on to sink, in the order they came */
+    void replay(ClauseSink& sink) const;
+    void clear() { data.clear(); }
+
+private:
+    std::vector<int32_t> data;      // count, then the literals, clause after clause
+};
+
+/** @brief groups up to this size get pairwise at-most-one clauses, larger ones the ladder encoding */
+const uint32_t PAIRWISE_MAX = 6;
+
+/** @brief auxiliary variables gen_exactly_one() takes for a group of count variables */
+inline uint32_t exactly_one_aux(uint32_t count) { return (count > PAIRWISE_MAX) ? count - 1 : 0; }
+
+/**
+ * @brief exactly one of vars: one clause of them all, then at most one of them, pairwise or by the
+ * ladder encoding (see PAIRWISE_MAX). aux is the next auxiliary variable, advanced past the ones taken
+ */
+void gen_exactly_one(const int32_t* vars, uint32_t count, ClauseSink& sink, uint32_t& aux);
+
+/** @brief box size from which clause generation is worth threads (36x36 boards) */
+const uint32_t PARALLEL_MIN_SIZE = 6;
+
+/**
+ * @brief run gen_task(task, task_sink) for each task of [0, task_num) on threads threads; sink gets
+ * the clauses in task order, as if the tasks had run one after the other on it.
+ *
+ * tasks run a window of a few per thread at a time into their own ClauseBuffer, then the window
+ * is passed on to sink: memory is bounded by the window, not the whole CNF. with one thread the
+ * tasks write straight into sink.
+ */
+void generate_in_order(uint32_t task_num, uint32_t threads, const std::function<void(uint32_t, ClauseSink&)>& gen_task, ClauseSink& sink);
+
+#endif /* end of include guard: __CLAUSE_SINK_H__ */
@@ -0,0 +1,148 @@
+/**
+ * @file compressed_stream.cpp
+ * @brief gzip-compressed batch files: an input decompressed on its own thread, an output compressed as it is written.
+ */
+
+#include "compressed_stream.h"
+
+#include <cstdio>
+#include <iostream>
+#include <zlib.h>
+
+bool is_gzip_file(const std::string& name){
+    std::FILE* file = std::fopen(name.c_str(), "rb");
+    if( file == nullptr ){
+        return false;
+    }
+    unsigned char magic[2] = {0, 0};
+    size_t read = std::fread(magic, 1, 2, file);
+    std::fclose(file);
+    return read == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+}
+
+bool is_gzip_name(const std::string& name){
+    return name.size() > 3 && name.compare(name.size() - 3, 3, ".gz") == 0;
+}
+
+bool gunzip(const char* data, size_t size, std::string& out){
+    z_stream stream{};
+    if( inflateInit2(&stream, 15 + 16) != Z_OK ){     // 15 + 16: gzip header and trailer
+        return false;
+    }
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream.avail_in = size;
+    char chunk[1 << 16];
+    int status = Z_OK;
+    while( status != Z_STREAM_END || stream.avail_in > 0 ){
+        if( status == Z_STREAM_END ){
+            inflateReset(&stream);      // the next member
+        }
+        stream.next_out = reinterpret_cast<Bytef*>(chunk);
+        stream.avail_out = sizeof(chunk);
+        status = ::inflate(&stream, Z_NO_FLUSH);
+        if( status != Z_OK && status != Z_STREAM_END ){
+            break;
+        }
+        out.append(chunk, sizeof(chunk) - stream.avail_out);
+    }
+    inflateEnd(&stream);
+    return status == Z_STREAM_END;
+}
+
+DecompressingStreambuf::~DecompressingStreambuf(){
+    stop = true;
+    if( thread.joinable() ){
+        thread.join();
+    }
+}
+
+bool DecompressingStreambuf::open(const std::string& name){
+    gzFile file = gzopen(name.c_str(), "rb");
+    if( file == nullptr ){
+        return false;
+    }
+    gzbuffer(file, CHUNK);
+    thread = std::thread(&DecompressingStreambuf::inflate, this, static_cast<void*>(file));
+    return true;
+}
+
+void DecompressingStreambuf::inflate(void* handle){
+    gzFile file = static_cast<gzFile>(handle);
+    while( !stop ){
+        std::string chunk(CHUNK, '\0');
+        int read = gzread(file, &chunk[0], CHUNK);
+        if( read <= 0 ){
+            int code;
+            const char* message = gzerror(file, &code);
+            if( code != Z_OK ){     // (Z_BUF_ERROR at the end of a truncated file)
+                std::cerr << "input file error: " << message << std::endl;
+            }
+            break;
+        }
+        chunk.resize(read);
+        // push() would wait for ever on a reader that stopped early
+        for( uint32_t round = 0; !chunks.try_push(chunk) && !stop; ){
+            backoff(round);
+        }
+    }
+    gzclose(file);
+    chunks.close();
+}
+
+DecompressingStreambuf::int_type DecompressingStreambuf::underflow(){
+    if( gptr() < egptr() ){
+        return traits_type::to_int_type(*gptr());
+    }
+    if( !chunks.pop(current) ){
+        return traits_type::eof();
+    }
+    setg(&current[0], &current[0], &current[0] + current.size());
+    return traits_type::to_int_type(*gptr());
+}
+
+CompressingStreambuf::~CompressingStreambuf(){
+    if( file != nullptr ){
+        flush_buffer();
+        if( gzclose(static_cast<gzFile>(file)) != Z_OK ){
+            failed = true;
+        }
+        if( failed ){
+            std::cerr << "output file error: compressed output incomplete" << std::endl;
+        }
+    }
+}
+
+bool CompressingStreambuf::open(const std::string& name){
+    file = gzopen(name.c_str(), "wb6");
+    if( file == nullptr ){
+        return false;
+    }
+    buffer.assign(CHUNK, '\0');
+    setp(&buffer[0], &buffer[0] + buffer.size());
+    return true;
+}
+
+bool CompressingStreambuf::flush_buffer(){
+    int size = static_cast<int>(pptr() - pbase());
+    if( size > 0 && gzwrite(static_cast<gzFile>(file), pbase(), size) != size ){
+        failed = true;
+    }
+    setp(&buffer[0], &buffer[0] + buffer.size());
+    return !failed;
+}
+
+CompressingStreambuf::int_type CompressingStreambuf::overflow(int_type c){
+    if( file == nullptr || !flush_buffer() ){
+        return traits_type::eof();
+    }
+    if( !traits_type::eq_int_type(c, traits_type::eof()) ){
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int CompressingStreambuf::sync(){
+    // the buffer goes to zlib, which keeps compressing into the same gzip member
+    return (file != nullptr && flush_buffer()) ? 0 : -1;
+}
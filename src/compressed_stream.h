@@ -0,0 +1,84 @@
+/**
+ * @file compressed_stream.h
+ * @brief gzip-compressed batch files: an input decompressed on its own thread, an output compressed as it is written.
+ *
+ * an input file starting with the gzip magic bytes is decompressed by zlib (one member or several
+ * concatenated, as by cat a.gz b.gz > c.gz); a decompression thread inflates it CHUNK bytes at a
+ * time into a BoundedQueue of QUEUE_CHUNKS chunks, and the istream reading it (the parse stage of
+ * solve_batch) takes each chunk as its get area. inflating the next chunks thus overlaps with
+ * parsing and solving, and memory stays at a few chunks whatever the size of the file.
+ *
+ * an output file whose name ends in .gz is written compressed (gzip level 6) through a buffer of
+ * CHUNK bytes; answers are written by the write stage of the pipeline, already its own thread.
+ *
+ * zstd is not supported: libzstd is not available where this is built, zlib comes with MiniSat.
+ */
+
+#ifndef __COMPRESSED_STREAM_H__
+#define __COMPRESSED_STREAM_H__
+
+#include <atomic>
+#include <string>
+#include <streambuf>
+#include <thread>
+
+#include "bounded_queue.h"
+
+/** @brief the file starts with the gzip magic bytes (false if it cannot be read) */
+bool is_gzip_file(const std::string& name);
+/** @brief name ends in .gz: an output to compress */
+bool is_gzip_name(const std::string& name);
+/** @brief gzip data in memory, all of it (members one after the other) appended to out; false if corrupt */
+bool gunzip(const char* data, size_t size, std::string& out);
+
+class DecompressingStreambuf : public std::streambuf {
+public:
+    static const size_t CHUNK = 1 << 18;
+    static const size_t QUEUE_CHUNKS = 8;
+
+    DecompressingStreambuf() : chunks("inflated", QUEUE_CHUNKS) {}
+    DecompressingStreambuf(const DecompressingStreambuf&) = delete;
+    /** @brief stops the decompression thread, even if the input was not read to its end */
+    ~DecompressingStreambuf();
+
+    /** @brief open name and start decompressing it; false if it cannot be opened */
+    bool open(const std::string& name);
+
+protected:
+    int_type underflow() override;
+
+private:
+    BoundedQueue<std::string> chunks;
+    std::string current;            // the get area
+    std::thread thread;
+    std::atomic<bool> stop{false};
+
+    /** @brief the decompression thread: file is a gzFile */
+    void inflate(void* file);
+};
+
+class CompressingStreambuf : public std::streambuf {
+public:
+    static const size_t CHUNK = 1 << 16;
+
+    CompressingStreambuf() {}
+    CompressingStreambuf(const CompressingStreambuf&) = delete;
+    /** @brief flushes and closes */
+    ~CompressingStreambuf();
+
+    /** @brief create or truncate name; false if it cannot be opened */
+    bool open(const std::string& name);
+
+protected:
+    int_type overflow(int_type c) override;
+    int sync() override;
+
+private:
+    void* file = nullptr;           // gzFile
+    std::string buffer;             // the put area
+    bool failed = false;
+
+    bool flush_buffer();
+};
+
+#endif /* end of include guard: __COMPRESSED_STREAM_H__ */
@@ -0,0 +1,253 @@
+/**
+ * @file disk_cache.cpp
+ * @brief persistent solution cache: an append-only hash table in a memory-mapped file, shared by processes.
+ */
+
+#include "disk_cache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && sizeof(std::atomic<uint64_t>) == 8, "the cache file needs lock-free 64-bit atomics (shared between processes)");
+
+namespace {
+
+const char MAGIC[8] = { 'S', 'U', 'D', 'O', 'K', 'U', 'C', '1' };
+const uint32_t BUCKET_BITS = 16;
+const size_t INITIAL_DATA_SIZE = 1 << 20;
+
+/** @brief FNV-1a, stable across processes and builds (std::hash is not) */
+uint64_t fingerprint_of(const CanonicalKey& key){
+    uint64_t hash = 14695981039346656037ULL;
+    for( const auto& cell : key ){
+        hash = (hash ^ (cell & 0xff)) * 1099511628211ULL;
+        hash = (hash ^ (cell >> 8)) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/** @brief bits per cell: enough for the largest number, which is the number of cells in a row */
+uint32_t cell_bits(size_t cells){
+    uint32_t size_square = 1;
+    while( size_square * size_square < cells ){
+        size_square++;
+    }
+    uint32_t bits = 1;
+    while( (1u << bits) <= size_square ){
+        bits++;
+    }
+    return bits;
+}
+
+size_t packed_size(size_t cells, uint32_t bits) { return (cells * bits + 7) / 8; }
+
+void pack(const CanonicalKey& cells, uint32_t bits, uint8_t* out){
+    std::memset(out, 0, packed_size(cells.size(), bits));
+    size_t bit = 0;
+    for( const auto& cell : cells ){
+        for( uint32_t i = 0; i < bits; i++, bit++ ){
+            out[bit/8] |= ((cell >> i) & 1) << (bit%8);
+        }
+    }
+}
+
+CanonicalKey unpack(const uint8_t* in, size_t cells, uint32_t bits){
+    CanonicalKey ret(cells, 0);
+    size_t bit = 0;
+    for( auto& cell : ret ){
+        for( uint32_t i = 0; i < bits; i++, bit++ ){
+            cell |= ((in[bit/8] >> (bit%8)) & 1) << i;
+        }
+    }
+    return ret;
+}
+
+} // namespace
+
+struct DiskSolutionCache::Header {
+    char magic[8];
+    uint32_t bucket_bits;
+    uint32_t reserved;
+    std::atomic<uint64_t> data_end;     // offset past the last published record
+};
+
+struct DiskSolutionCache::Record {
+    uint64_t next;          // offset of the previous head of the bucket, 0 for none
+    uint64_t fingerprint;
+    uint32_t cells;
+    uint32_t has_solution;
+};
+
+const size_t BUCKETS_OFFSET = 64;
+
+std::atomic<uint64_t>& DiskSolutionCache::bucket(uint64_t fingerprint) const {
+    uint64_t index = fingerprint & ((uint64_t(1) << header()->bucket_bits) - 1);
+    return reinterpret_cast<std::atomic<uint64_t>*>(map + BUCKETS_OFFSET)[index];
+}
+
+DiskSolutionCache::~DiskSolutionCache(){
+    if( map != nullptr ){
+        munmap(map, map_size);
+    }
+    if( fd != -1 ){
+        close(fd);
+    }
+}
+
+bool DiskSolutionCache::open(const std::string& path){
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    writable = (fd != -1);
+    if( fd == -1 ){
+        fd = ::open(path.c_str(), O_RDONLY);
+    }
+    if( fd == -1 ){
+        std::cerr << "cache file: cannot open " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // a new file is set up under the writer lock, so nobody sees it half written
+    const size_t data_start = BUCKETS_OFFSET + (sizeof(uint64_t) << BUCKET_BITS);
+    flock(fd, writable ? LOCK_EX : LOCK_SH);
+    struct stat st;
+    bool ok = (fstat(fd, &st) == 0);
+    if( ok && st.st_size == 0 && writable ){
+        ok = (ftruncate(fd, data_start + INITIAL_DATA_SIZE) == 0);
+        Header init;
+        std::memcpy(init.magic, MAGIC, sizeof(MAGIC));
+        init.bucket_bits = BUCKET_BITS;
+        init.reserved = 0;
+        init.data_end.store(data_start, std::memory_order_relaxed);
+        ok = ok && pwrite(fd, &init, sizeof(init), 0) == sizeof(init);
+    }
+    ok = ok && remap();
+    flock(fd, LOCK_UN);
+
+    if( !ok || map_size < BUCKETS_OFFSET || std::memcmp(header()->magic, MAGIC, sizeof(MAGIC)) != 0
+        || map_size < BUCKETS_OFFSET + (sizeof(uint64_t) << header()->bucket_bits) ){
+        std::cerr << "cache file: " << path << " is not a solution cache" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool DiskSolutionCache::remap(){
+    struct stat st;
+    if( fstat(fd, &st) != 0 ){
+        return false;
+    }
+    if( map != nullptr ){
+        munmap(map, map_size);
+        map = nullptr;
+    }
+    map_size = st.st_size;
+    if( map_size == 0 ){
+        return true;
+    }
+    void* addr = mmap(nullptr, map_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    if( addr == MAP_FAILED ){
+        map_size = 0;
+        return false;
+    }
+    map = static_cast<uint8_t*>(addr);
+    return true;
+}
+
+const DiskSolutionCache::Record* DiskSolutionCache::record_at(uint64_t offset){
+    if( offset + sizeof(Record) > map_size && !remap() ){
+        return nullptr;
+    }
+    if( offset + sizeof(Record) > map_size ){
+        return nullptr;
+    }
+    const Record* record = reinterpret_cast<const Record*>(map + offset);
+    size_t bits = cell_bits(record->cells);
+    size_t end = offset + sizeof(Record) + packed_size(record->cells, bits) * (record->has_solution ? 2 : 1);
+    if( end > map_size && (!remap() || end > map_size) ){
+        return nullptr;
+    }
+    return reinterpret_cast<const Record*>(map + offset);
+}
+
+const DiskSolutionCache::Record* DiskSolutionCache::find(const CanonicalKey& key, uint64_t fingerprint){
+    uint64_t offset = bucket(fingerprint).load(std::memory_order_acquire);
+    while( offset != 0 ){
+        const Record* record = record_at(offset);
+        if( record == nullptr ){
+            return nullptr;
+        }
+        if( record->fingerprint == fingerprint && record->cells == key.size() ){
+            const uint8_t* packed_key = reinterpret_cast<const uint8_t*>(record + 1);
+            if( unpack(packed_key, key.size(), cell_bits(key.size())) == key ){
+                return record;
+            }
+        }
+        offset = record->next;
+    }
+    return nullptr;
+}
+
+bool DiskSolutionCache::lookup(const CanonicalKey& key, CanonicalKey& solution){
+    if( map == nullptr ){
+        return false;
+    }
+    const Record* record = find(key, fingerprint_of(key));
+    if( record == nullptr ){
+        return false;
+    }
+    solution.clear();
+    if( record->has_solution ){
+        uint32_t bits = cell_bits(key.size());
+        const uint8_t* packed_solution = reinterpret_cast<const uint8_t*>(record + 1) + packed_size(key.size(), bits);
+        solution = unpack(packed_solution, key.size(), bits);
+    }
+    return true;
+}
+
+void DiskSolutionCache::insert(const CanonicalKey& key, const CanonicalKey& solution){
+    if( map == nullptr || !writable ){
+        return;
+    }
+    const uint64_t fingerprint = fingerprint_of(key);
+    const uint32_t bits = cell_bits(key.size());
+    const size_t packed = packed_size(key.size(), bits);
+    const size_t record_size = (sizeof(Record) + packed * (solution.empty() ? 1 : 2) + 7) & ~size_t(7);
+
+    flock(fd, LOCK_EX);
+    // another process may have added it, or grown the file, since we last looked
+    if( find(key, fingerprint) == nullptr ){
+        uint64_t end = header()->data_end.load(std::memory_order_acquire);
+        bool ok = true;
+        if( end + record_size > map_size ){
+            ok = remap();
+            if( ok && end + record_size > map_size ){
+                ok = ftruncate(fd, std::max(2 * map_size, end + record_size)) == 0 && remap();
+            }
+        }
+        if( ok ){
+            std::vector<uint8_t> buffer(record_size, 0);
+            Record* record = reinterpret_cast<Record*>(buffer.data());
+            record->next = bucket(fingerprint).load(std::memory_order_relaxed);
+            record->fingerprint = fingerprint;
+            record->cells = key.size();
+            record->has_solution = !solution.empty();
+            pack(key, bits, buffer.data() + sizeof(Record));
+            if( !solution.empty() ){
+                pack(solution, bits, buffer.data() + sizeof(Record) + packed);
+            }
+            std::memcpy(map + end, buffer.data(), record_size);
+
+            header()->data_end.store(end + record_size, std::memory_order_release);
+            bucket(fingerprint).store(end, std::memory_order_release);
+        }
+    }
+    flock(fd, LOCK_UN);
+}
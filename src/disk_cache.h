@@ -0,0 +1,60 @@
+/**
+ * @file disk_cache.h
+ * @brief persistent solution cache: an append-only hash table in a memory-mapped file, shared by processes.
+ *
+ * file layout (native byte order, the file is not meant to move between machines):
+ *   header   magic, table size, end of the records (data_end)
+ *   buckets  1 << bucket_bits offsets of the newest record of each bucket, 0 for none
+ *   records  Record, packed canonical key, packed solution (none for "no solution"), 8-byte aligned
+ *
+ * a record is written once and never changed. the single writer (flock() on the file) writes it past
+ * data_end, then publishes it by storing data_end and the bucket head, both with release order; the
+ * record links to the previous head. readers take no lock: they load the bucket head with acquire
+ * order and follow the links, remapping when a record lies past what they have mapped. a writer
+ * that dies before publishing leaves only unreachable bytes, overwritten by the next append.
+ */
+
+#ifndef __DISK_CACHE_H__
+#define __DISK_CACHE_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "solution_cache.h"
+
+class DiskSolutionCache {
+public:
+    DiskSolutionCache() = default;
+    ~DiskSolutionCache();
+    DiskSolutionCache(const DiskSolutionCache&) = delete;
+    DiskSolutionCache& operator=(const DiskSolutionCache&) = delete;
+
+    /** @brief open or create path, read-only if it cannot be written; false (and a message on std::cerr) on error */
+    bool open(const std::string& path);
+
+    /** @brief true if key is in the file, solution gets its solution (empty for no solution) */
+    bool lookup(const CanonicalKey& key, CanonicalKey& solution);
+    /** @brief append key and its solution (empty for no solution), unless the file has it already */
+    void insert(const CanonicalKey& key, const CanonicalKey& solution);
+
+private:
+    struct Header;
+    struct Record;
+
+    int fd = -1;
+    bool writable = false;
+    uint8_t* map = nullptr;
+    size_t map_size = 0;
+
+    Header* header() const { return reinterpret_cast<Header*>(map); }
+    std::atomic<uint64_t>& bucket(uint64_t fingerprint) const;
+    /** @brief map the whole file again, after it grew */
+    bool remap();
+    /** @brief record at offset, remapping if needed; nullptr if the file is shorter (corrupt) */
+    const Record* record_at(uint64_t offset);
+    const Record* find(const CanonicalKey& key, uint64_t fingerprint);
+};
+
+#endif /* end of include guard: __DISK_CACHE_H__ */
@@ -0,0 +1,149 @@
+/**
+ * @file latency_histogram.cpp
+ * @brief per-puzzle latency of each phase of a batch, in HDR-style histograms per board size.
+ */
+
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+uint32_t LatencyHistogram::bucket_of(uint64_t ns){
+    ns = std::min(ns, (uint64_t(1) << MAX_BITS) - 1);
+    if( ns < (uint64_t(1) << SUB_BITS) ){
+        return static_cast<uint32_t>(ns);
+    }
+    // the top SUB_BITS bits of ns, in the buckets of its power of two
+    uint32_t shift = (63 - __builtin_clzll(ns)) - (SUB_BITS - 1);
+    return (shift << (SUB_BITS - 1)) + static_cast<uint32_t>(ns >> shift);
+}
+
+uint64_t LatencyHistogram::highest_of(uint32_t bucket){
+    if( bucket < (1u << SUB_BITS) ){
+        return bucket;
+    }
+    uint32_t shift = (bucket >> (SUB_BITS - 1)) - 1;
+    uint64_t sub = bucket - (shift << (SUB_BITS - 1));
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t ns){
+    // one writer: a load and a store, no read-modify-write
+    std::atomic<uint64_t>& bucket = counts[bucket_of(ns)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    total.store(total.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if( ns > largest.load(std::memory_order_relaxed) ){
+        largest.store(ns, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other){
+    uint64_t merged = 0;
+    for( uint32_t i = 0; i < BUCKETS; i++ ){
+        uint64_t count = other.counts[i].load(std::memory_order_relaxed);
+        if( count > 0 ){
+            counts[i].store(counts[i].load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+            merged += count;
+        }
+    }
+    // the buckets read, not other.total: a record may have come in between
+    total.store(total.load(std::memory_order_relaxed) + merged, std::memory_order_relaxed);
+    largest.store(std::max(largest.load(std::memory_order_relaxed), other.max()), std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::percentile(double fraction) const {
+    uint64_t values = count();
+    if( values == 0 ){
+        return 0;
+    }
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * values + 0.5));
+    uint64_t seen = 0;
+    for( uint32_t i = 0; i < BUCKETS; i++ ){
+        seen += counts[i].load(std::memory_order_relaxed);
+        if( seen >= rank ){
+            return std::min(highest_of(i), max());
+        }
+    }
+    return max();
+}
+
+const char* latency_phase_name(LatencyPhase phase){
+    static const char* const NAMES[LATENCY_PHASES] = {"parse", "encode", "solve", "write", "total"};
+    return NAMES[static_cast<uint32_t>(phase)];
+}
+
+LatencyRecorder::~LatencyRecorder(){
+    for( auto& slot : slots ){
+        delete slot.load();
+    }
+}
+
+uint32_t LatencyRecorder::slot_of(uint32_t size, LatencyPhase phase){
+    return (size < MAX_SIZE ? size : MAX_SIZE) * LATENCY_PHASES + static_cast<uint32_t>(phase);
+}
+
+void LatencyRecorder::record(uint32_t size, LatencyPhase phase, uint64_t ns){
+    std::atomic<LatencyHistogram*>& slot = slots[slot_of(size, phase)];
+    LatencyHistogram* histogram = slot.load(std::memory_order_relaxed);
+    if( histogram == nullptr ){
+        histogram = new LatencyHistogram;
+        slot.store(histogram, std::memory_order_release);
+    }
+    histogram->record(ns);
+}
+
+const LatencyHistogram* LatencyRecorder::histogram(uint32_t size, LatencyPhase phase) const {
+    return slots[slot_of(size, phase)].load(std::memory_order_acquire);
+}
+
+namespace {
+
+/** @brief ns in the unit that keeps 3 or 4 digits */
+std::string format_ns(uint64_t ns){
+    char text[32];
+    if( ns < 10000 ){
+        std::snprintf(text, sizeof(text), "%llu ns", static_cast<unsigned long long>(ns));
+    }
+    else if( ns < 10000000 ){
+        std::snprintf(text, sizeof(text), "%.1f us", ns / 1e3);
+    }
+    else if( ns < 10000000000ull ){
+        std::snprintf(text, sizeof(text), "%.1f ms", ns / 1e6);
+    }
+    else{
+        std::snprintf(text, sizeof(text), "%.1f s", ns / 1e9);
+    }
+    return text;
+}
+
+}
+
+void print_latency(std::ostream& out, const std::vector<const LatencyRecorder*>& recorders){
+    for( uint32_t size = 0; size <= LatencyRecorder::MAX_SIZE; size++ ){
+        for( uint32_t phase = 0; phase < LATENCY_PHASES; phase++ ){
+            std::unique_ptr<LatencyHistogram> merged(new LatencyHistogram);
+            for( const LatencyRecorder* recorder : recorders ){
+                const LatencyHistogram* histogram = recorder->histogram(size, static_cast<LatencyPhase>(phase));
+                if( histogram != nullptr ){
+                    merged->merge(*histogram);
+                }
+            }
+            if( merged->count() == 0 ){
+                continue;
+            }
+            char board[32];
+            uint32_t side = size * size;
+            std::snprintf(board, sizeof(board), size == LatencyRecorder::MAX_SIZE ? "%ux%u+" : "%ux%u", side, side);
+            char line[256];
+            std::snprintf(line, sizeof(line), "latency %-9s %-6s: %8llu puzzles, p50 %s, p90 %s, p99 %s, p999 %s, max %s",
+                          board, latency_phase_name(static_cast<LatencyPhase>(phase)),
+                          static_cast<unsigned long long>(merged->count()),
+                          format_ns(merged->percentile(0.5)).c_str(), format_ns(merged->percentile(0.9)).c_str(),
+                          format_ns(merged->percentile(0.99)).c_str(), format_ns(merged->percentile(0.999)).c_str(),
+                          format_ns(merged->max()).c_str());
+            out << line << "\n";
+        }
+    }
+    out.flush();
+}
@@ -0,0 +1,82 @@
+/**
+ * @file latency_histogram.h
+ * @brief per-puzzle latency of each phase of a batch, in HDR-style histograms per board size.
+ *
+ * a histogram counts nanoseconds in log-linear buckets: exact below 2^SUB_BITS, then 2^(SUB_BITS-1)
+ * buckets per power of two, so a percentile is off by less than 1 / 2^(SUB_BITS-1) (1.6%) of it,
+ * from 1 ns up to hours, in a fixed 20 KB.
+ *
+ * each thread of the pipeline records into its own LatencyRecorder (one writer per histogram, no
+ * lock, no shared cache line). the counts are relaxed atomics, so a report can merge the recorders
+ * while they are still written, from any thread: a dump during a batch sees each count either
+ * before or after a record, never torn.
+ */
+
+#ifndef __LATENCY_HISTOGRAM_H__
+#define __LATENCY_HISTOGRAM_H__
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+class LatencyHistogram {
+public:
+    static const uint32_t SUB_BITS = 7;
+    static const uint32_t MAX_BITS = 44;    // values from 2^44 ns (4.9 hours) on are counted as 2^44 - 1
+    static const uint32_t BUCKETS = (MAX_BITS - SUB_BITS + 2) << (SUB_BITS - 1);
+
+    /** @brief by the one thread owning the histogram */
+    void record(uint64_t ns);
+    /** @brief add the counts of other, which may be being recorded into */
+    void merge(const LatencyHistogram& other);
+
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    uint64_t max() const { return largest.load(std::memory_order_relaxed); }
+    /** @brief the value under which fraction (0 to 1) of the values are, to the precision of a bucket */
+    uint64_t percentile(double fraction) const;
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> counts{};
+    std::atomic<uint64_t> total{0}, largest{0};
+
+    static uint32_t bucket_of(uint64_t ns);
+    /** @brief largest value of bucket */
+    static uint64_t highest_of(uint32_t bucket);
+};
+
+/** @brief phases of a puzzle in solve_batch(); TOTAL is from the start of its parse to its answer written */
+enum class LatencyPhase { PARSE, ENCODE, SOLVE, WRITE, TOTAL };
+const uint32_t LATENCY_PHASES = 5;
+const char* latency_phase_name(LatencyPhase phase);
+
+/** @brief the histograms of one thread, per box size and phase, made when first recorded into */
+class LatencyRecorder {
+public:
+    /** @brief box sizes up to this get their own histograms, larger ones share the last slot */
+    static const uint32_t MAX_SIZE = 16;
+
+    LatencyRecorder() {}
+    LatencyRecorder(const LatencyRecorder&) = delete;
+    ~LatencyRecorder();
+
+    /** @brief by the thread owning the recorder */
+    void record(uint32_t size, LatencyPhase phase, uint64_t ns);
+    /** @brief nullptr if nothing was recorded for size yet; safe from any thread */
+    const LatencyHistogram* histogram(uint32_t size, LatencyPhase phase) const;
+
+private:
+    std::array<std::atomic<LatencyHistogram*>, (MAX_SIZE + 1) * LATENCY_PHASES> slots{};
+
+    static uint32_t slot_of(uint32_t size, LatencyPhase phase);
+};
+
+/**
+ * @brief merge recorders and print, per box size and phase, count and p50/p90/p99/p999/max;
+ * recorders may be still recorded into.
+ */
+void print_latency(std::ostream& out, const std::vector<const LatencyRecorder*>& recorders);
+
+#endif /* end of include guard: __LATENCY_HISTOGRAM_H__ */
@@ -4,157 +4,1154 @@
  */
 
 /* 
- * usage: ./solver [Input Puzzle] [Output Puzzle] [MiniSatExe] 
+ * usage: ./sudoku_solver [options] [Input Puzzle] [Output Puzzle] [MiniSatExe]
+ *        ./sudoku_solver --verify [Input Puzzle] [Output Puzzle]
+ *        ./sudoku_solver --write-skeleton=SIZE [Skeleton File]
+ *
+ *   the input file may hold several puzzles separated by blank lines, the output file gets
+ *   one answer per puzzle (solution, NO or TIMEOUT; ERROR for a malformed one) in the same order,
+ *   separated the same way.
+ *   a gzip input is decompressed on a thread of its own as it is read; an output named *.gz is written
+ *   gzip-compressed, see compressed_stream.h.
+ *
+ *   puzzles are solved by MiniSat in-process; MiniSatExe (optional) is run when that gives up.
+ *
+ *   --perf            hardware counters per phase and per MiniSat function, see PerfCounters.h
+ *   --mem             peak RSS at the end of each stage, bytes of the encoder and of each part of MiniSat
+ *   --latency         p50/p90/p99/p999/max latency per board size and phase, see latency_histogram.h;
+ *                     SIGUSR1 prints them during a batch
+ *   --slowest=N       write the N slowest puzzles (end to end) to [Output Puzzle].slowest, slowest first
+ *   --time-limit=T    seconds per puzzle (wall-clock), shared by all attempts
+ *   --conflicts=N     conflict budget of the first attempt, doubled for each retry
+ *   --propagations=N  propagation budget of the first attempt, doubled for each retry
+ *   --retries=N       in-process attempts with other parameters after one gave up (default 2)
+ *   --external        skip the in-process solver, only run MiniSatExe
+ *   --dimacs          give MiniSatExe DIMACS instead of BCNF (for solvers other than MiniSat 1.14)
+ *   --cache=N         solutions of up to N puzzles (up to symmetry) are kept and reused (default 4096, 0: off)
+ *   --cache-file=F    also keep them in file F, shared with other runs and processes, see disk_cache.h
+ *   --workers=N       split the input among N worker processes, see shard_coordinator.h
+ *   --solvers=N       threads solving puzzles at the same time, see solve_batch() (default 1)
+ *   --threads=N       threads generating the clauses of 36x36 and larger boards, and solving cubes (default: cores / (workers * solvers))
+ *   --checkpoint=DIR  save the search of each in-process solve to DIR every minute and when it gives up, resume from
+ *                     there on the same puzzle (a retry or a later run); SIGTERM gives up as SIGINT does
+ *   --cubes=N         cube-and-conquer: split each puzzle into about N cubes solved on --threads threads, see SatBackend::solve_cubes()
+ *   --skeleton=DIR    specialise DIR/skeleton_<size>.bin for boards of sizes 2 and 7 up, see sudoku_skeleton.h
+ *   --check           verify each solution before it is written, ERROR for a wrong one
+ *   --no-hints        plain VSIDS and polarity: no branching hints from the candidates (see SudokuSolver::gen_hints())
+ *
+ *   --verify          only check the answers in Output Puzzle against Input Puzzle, see sudoku_verifier.h
+ *   --write-skeleton  only write the skeleton of boards with boxes of SIZE x SIZE cells
  */
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <vector>
+#include <atomic>
+#include <chrono>
+#include <csignal>
 #include <cstdint>
+#include <cstdio>
 #include <cmath>
 #include <cstdlib>
+#include <functional>
+#include <map>
+#include <queue>
+#include <tuple>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+
+#include <unistd.h>
+#include <sys/resource.h>
 
 #include "sudoku_solver.h"
+#include "sudoku_solver_fixed.h"
+#include "sat_backend.h"
+#include "solution_cache.h"
+#include "disk_cache.h"
+#include "shard_coordinator.h"
+#include "sudoku_verifier.h"
+#include "sudoku_skeleton.h"
+#include "bounded_queue.h"
+#include "compressed_stream.h"
 #include "utils.h"
+#include "latency_histogram.h"
+#include "PerfCounters.h"
 
 // const char WHITESPACE[] = " \t\r\n\v\f"
 const char DIGIT[] = "0123456789";
 const char DIGIT_NEG[] = "-0123456789";
 
+/** @brief command line options, see the usage above */
+struct Options {
+    bool perf = false;
+    bool mem = false;
+    bool latency = false;
+    uint32_t slowest = 0;               // 0: none
+    bool external = false;
+    bool dimacs = false;
+    double time_limit = 0;              // 0: no limit
+    int64_t conflict_limit = -1;        // negative: no limit
+    int64_t propagation_limit = -1;
+    int retries = 2;
+    size_t cache_size = 4096;
+    std::string cache_file;             // empty: none
+    uint32_t workers = 1;
+    uint32_t solvers = 1;
+    uint32_t threads = 0;               // 0: cores / (workers * solvers)
+    uint32_t cubes = 0;                 // 0, 1: no split
+    std::string checkpoint_dir;         // empty: no checkpoints
+    bool check = false;
+    bool hints = true;
+    bool verify = false;
+    std::string skeleton_dir;           // empty: none
+    uint32_t write_skeleton = 0;        // box size, 0: solve
+
+    std::string input_name;
+    std::string output_name;
+    std::string minisat_exe_name;       // empty: no external fallback
+};
+
+/** @brief set by SIGINT or SIGTERM: the running solve returns UNKNOWN and no further puzzle is started */
+std::atomic<bool> interrupted(false);
+
+void sigint_handler(int signum){
+    interrupted = true;
+    std::signal(signum, SIG_DFL);   // a second Ctrl-C kills the process
+}
+
+/** @brief set by SIGUSR1 (with --latency): the latency so far is printed */
+std::atomic<bool> latency_requested(false);
+
+void sigusr1_handler(int){
+    latency_requested = true;
+}
+
+bool parse_options(int argc, char *argv[], Options& options);
+enum class PuzzleRead { OK, END, MALFORMED };
+/**
+ * @brief parse one puzzle (skipping blank lines before it); END at end of input. a malformed puzzle is
+ * skipped up to the blank line after it (where the next one starts) and MALFORMED returned.
+ */
+PuzzleRead read_puzzle(std::istream& input_file, vector_2d<uint32_t>& sudoku_puzzle, uint32_t& sudoku_size);
 /** @brief parse sudoku input, parse single line */
 std::vector<uint32_t> parse_line(std::string line);
 /** @brief parse SAT solver output, split SAT solution(variable = true/false) */
 std::vector<int32_t> split_number(std::string line);
 
 void print_sudoku_puzzle(const vector_2d<uint32_t>& puzzle);
-void print_sudoku_solution(std::fstream& output_file, const vector_2d<uint32_t>& puzzle);
+void print_sudoku_solution(std::ostream& output_file, const vector_2d<uint32_t>& puzzle);
+int solve_batch(const Options& options, std::istream& input_file, AnswerWriter& answers, uint32_t skip);
+
+/** @brief the slowest puzzles end to end, as (latency ns, index in the batch, puzzle); the fastest of them on top */
+using SlowPuzzle = std::tuple<uint64_t, uint64_t, vector_2d<uint32_t>>;
+using SlowestPuzzles = std::priority_queue<SlowPuzzle, std::vector<SlowPuzzle>, std::greater<SlowPuzzle>>;
+/** @brief the puzzles of slowest to [Output Puzzle].slowest (.PID in a worker), slowest first, in the input format */
+void write_slowest(const Options& options, SlowestPuzzles& slowest);
 
-void minisat_solver(std::string executable, std::string& input_data, std::string& output_data, bool& is_satisfied){
-    const char INPUT_FILE[] = "/tmp/minisat_in";
-    const char OUTPUT_FILE[] = "/tmp/minisat_out";
+/** @brief peak resident set size of this process so far, in MB */
+double peak_memory_mb(){
+    struct rusage usage;
+    if( getrusage(RUSAGE_SELF, &usage) != 0 ){
+        return 0;
+    }
+    return usage.ru_maxrss / 1024.0;    // KB on Linux
+}
 
-    std::fstream sat_in(INPUT_FILE, std::ios::out);
+/** @brief an istream over memory (a mapped file), without copying it */
+struct MemoryStreambuf : public std::streambuf {
+    MemoryStreambuf(const char* begin, const char* end){
+        char* p = const_cast<char*>(begin);
+        setg(p, p, p + (end - begin));
+    }
+};
+
+/** @brief which options of the bundled MiniSat an executable takes (the original 1.14 takes none) */
+struct MinisatExeOptions {
+    bool perf = false;
+    bool time_limit = false;
+};
+
+/** @brief the options executable lists in its --help, read once per executable */
+MinisatExeOptions minisat_exe_options(const std::string& executable){
+    static std::mutex known_mutex;
+    static std::map<std::string, MinisatExeOptions> known;
+    std::lock_guard<std::mutex> lock(known_mutex);
+    auto found = known.find(executable);
+    if( found != known.end() ){
+        return found->second;
+    }
+
+    std::string help;
+    if( std::FILE* pipe = popen((executable + " --help < /dev/null 2>&1").c_str(), "r") ){
+        char buffer[4096];
+        for( size_t n; (n = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0; ){
+            help.append(buffer, n);
+        }
+        pclose(pipe);
+    }
+    MinisatExeOptions options;
+    options.perf = help.find("-perf") != std::string::npos;
+    options.time_limit = help.find("-time-limit=") != std::string::npos;
+    if( !options.perf || !options.time_limit ){
+        std::cerr << executable << " lists no" << (options.perf ? "" : " -perf") << (options.time_limit ? "" : " -time-limit")
+                  << " in its --help: run without (--perf and --time-limit need the MiniSat of minisat/MiniSat_v1.14)" << std::endl;
+    }
+    known.emplace(executable, options);
+    return options;
+}
+
+/**
+ * @brief run MiniSat executable on the CNF that write_input writes (BCNF or DIMACS), time_limit <= 0 means no limit.
+ * perf and time_limit are only passed on if the executable takes them, see minisat_exe_options().
+ * written straight into MiniSat's input file: for large boards the CNF is hundreds of MB.
+ */
+SatResult minisat_solver(std::string executable, const std::function<void(std::ostream&)>& write_input, bool bcnf, std::string& output_data, double time_limit, bool perf){
+    // per process and run: the workers of a coordinator, and the solve threads of one, run MiniSat
+    // at the same time (MiniSat reads an input named *.bcnf as BCNF)
+    static std::atomic<uint32_t> run_count(0);
+    const std::string RUN = std::to_string(getpid()) + "." + std::to_string(run_count++);
+    const std::string INPUT_FILE = "/tmp/minisat_in." + RUN + (bcnf ? ".bcnf" : ".cnf");
+    const std::string OUTPUT_FILE = "/tmp/minisat_out." + RUN;
+
+    std::fstream sat_in(INPUT_FILE, std::ios::out | std::ios::binary);
     if( !sat_in ){
         std::cerr << "open sat_in error" << std::endl;
         std::exit(1);
     }
-    sat_in << input_data;
+    write_input(sat_in);
     sat_in.close();
 
-    std::string command = executable + " " + INPUT_FILE + " " + OUTPUT_FILE;
+    // a crashed or killed MiniSat must not leave us the answer of an earlier run
+    std::remove(OUTPUT_FILE.c_str());
+
+    MinisatExeOptions takes = minisat_exe_options(executable);
+    std::string command = executable + (perf && takes.perf ? " -perf" : "");
+    if( time_limit > 0 && takes.time_limit ){
+        command += " -time-limit=" + std::to_string(time_limit);
+    }
+    command += " " + INPUT_FILE + " " + OUTPUT_FILE;
     std::cout << command << std::endl;
     std::system(command.c_str());
 
     std::fstream sat_out(OUTPUT_FILE, std::ios::in);
     if( !sat_out ){
         std::cerr << "open sat_out error" << std::endl;
-        std::exit(1);
+        return SatResult::UNKNOWN;
     }
     std::string sat_string;
     std::getline(sat_out, sat_string);
     std::getline(sat_out, output_data);
+    sat_out.close();
+    std::remove(INPUT_FILE.c_str());
+    std::remove(OUTPUT_FILE.c_str());
 
-    is_satisfied = false;
     if( sat_string == "SAT" ){
-        is_satisfied = true;
+        return SatResult::SAT;
     }
+    if( sat_string == "UNSAT" ){
+        return SatResult::UNSAT;
+    }
+    return SatResult::UNKNOWN;  // INDET: MiniSat ran out of time or was interrupted
+}
+
+/**
+ * @brief parameters of the in-process attempt number attempt (0 = first).
+ *
+ * a retry doubles the budgets and changes what most often decides how long MiniSat takes on a
+ * given instance: preprocessing, randomness of the decisions and the restart interval. the restart
+ * interval holds even when the retry resumes a checkpoint, which otherwise continues the restart
+ * limit it saved.
+ */
+SatParams attempt_params(const Options& options, int attempt){
+    SatParams params;
+    if( options.conflict_limit >= 0 ){
+        params.conflict_limit = options.conflict_limit << attempt;
+    }
+    if( options.propagation_limit >= 0 ){
+        params.propagation_limit = options.propagation_limit << attempt;
+    }
+    if( attempt > 0 ){
+        params.preprocess = (attempt % 2 == 0);
+        params.random_var_freq = 0.02 + 0.03 * attempt;
+        params.random_seed = 91648253 + 7919 * attempt;
+        params.restart_first = (attempt % 2 == 1) ? 50 : 200;
+    }
+    return params;
+}
+
+/**
+ * @brief solve the CNF of one puzzle: in-process attempts first, then MiniSatExe if given.
+ * the clauses are generated again for each attempt, straight into the solver or its input file;
+ * the in-process solver takes solver.variable_count(), the header of an input file the totals of a
+ * counting pass of solver.gen_clauses(), made only then.
+ *
+ * with a time limit, each in-process attempt gets an equal share of the time left, so the
+ * retries get to run even when the first attempt would have used all of it.
+ */
+template <class Solver>
+SatResult solve_cnf(Solver& solver, const Options& options, SatBackend& backend, std::vector<int32_t>& model){
+    auto start = std::chrono::steady_clock::now();
+    auto time_left = [&](){
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return options.time_limit - elapsed.count();
+    };
+
+    SatResult result = SatResult::UNKNOWN;
+    if( !options.external ){
+        SatHints hints;
+        if( options.hints ){
+            solver.gen_hints(hints);
+        }
+        std::vector<std::vector<int32_t>> cubes;
+        solver.gen_cubes(options.cubes, cubes);
+        auto gen_clauses = [&solver](ClauseSink& sink){ solver.gen_clauses(sink); };
+        for( int attempt = 0; attempt <= options.retries && !interrupted; attempt++ ){
+            SatParams params = attempt_params(options, attempt);
+            if( options.time_limit > 0 ){
+                if( time_left() <= 0 ){
+                    break;
+                }
+                params.time_limit = time_left() / (options.retries - attempt + 1);
+            }
 
-    return;
+            if( cubes.empty() ){
+                result = backend.solve(solver.variable_count(), gen_clauses, hints, params, model);
+            }
+            else{
+                result = backend.solve_cubes(solver.variable_count(), gen_clauses, hints, cubes, options.threads, params, model);
+            }
+            if( result != SatResult::UNKNOWN ){
+                return result;
+            }
+        }
+    }
+
+    if( !options.minisat_exe_name.empty() && !interrupted && (options.time_limit <= 0 || time_left() > 0) ){
+        std::string sat_output;
+        CountingSink count;
+        solver.gen_clauses(count);
+        auto write_input = [&](std::ostream& out){
+            if( options.dimacs ){
+                DimacsSink sink(out, count.var_num, count.clause_num);
+                solver.gen_clauses(sink);
+            }
+            else{
+                BcnfSink sink(out, count.var_num, count.clause_num);
+                solver.gen_clauses(sink);
+            }
+        };
+        result = minisat_solver(options.minisat_exe_name, write_input, !options.dimacs, sat_output, options.time_limit > 0 ? time_left() : 0, options.perf);
+        if( result == SatResult::SAT ){
+            model = split_number(sat_output);
+        }
+    }
+    return result;
 }
 
+/** @brief a puzzle encoded by the encode stage of solve_batch, for the solve and write stages */
+class PreparedPuzzle {
+public:
+    virtual ~PreparedPuzzle() {}
+    /** @brief 4., see solve_cnf() */
+    virtual SatResult solve(const Options& options, SatBackend& backend, std::vector<int32_t>& model) = 0;
+    /** @brief 5., the solution of a SAT model */
+    virtual void decode(const std::vector<int32_t>& model, vector_2d<uint32_t>& solution) = 0;
+    /** @brief bytes held by the solver's tables and encoder */
+    virtual size_t memory_bytes() const = 0;
+    /** @brief bytes held by the encoder alone (0 for FixedSudokuSolver) */
+    virtual size_t encoder_bytes() const = 0;
+};
+
+/** @brief a SudokuSolver or FixedSudokuSolver<N> after prepare() */
+template <class Solver>
+class PreparedSolver : public PreparedPuzzle {
+public:
+    Solver solver;
+
+    template <class... Args>
+    explicit PreparedSolver(Args&&... args) : solver(std::forward<Args>(args)...) {}
+
+    SatResult solve(const Options& options, SatBackend& backend, std::vector<int32_t>& model) override {
+        return solve_cnf(solver, options, backend, model);
+    }
+    void decode(const std::vector<int32_t>& model, vector_2d<uint32_t>& solution) override {
+        solver.decode(model);
+        solution = std::move(solver.puzzle);
+    }
+    size_t memory_bytes() const override {
+        return solver.memory_bytes();
+    }
+    size_t encoder_bytes() const override {
+        return solver.encoder_bytes();
+    }
+};
+
+/** @brief one puzzle on its way through the stages of solve_batch */
+struct BatchJob {
+    uint64_t index = 0;                         // in the batch: answers are written in this order
+    vector_2d<uint32_t> puzzle;
+    uint32_t size = 0;
+    CanonicalPuzzle canonical;
+    SolutionCache::Lookup cached = SolutionCache::Lookup::MISS;
+    std::unique_ptr<PreparedPuzzle> prepared;   // nullptr: answered by the cache, or not started (interrupted)
+    std::vector<int32_t> model;
+    SatResult result = SatResult::UNKNOWN;
+    bool malformed = false;                     // answered ERROR, neither cached nor solved
+    vector_2d<uint32_t> solution;
+    std::chrono::steady_clock::time_point started;  // its parse began
+};
+using JobPtr = std::unique_ptr<BatchJob>;
+
+/** @brief puzzles and working time of one stage of solve_batch, summed over its threads */
+struct StageStats {
+    const char* name;
+    uint32_t threads;
+    std::atomic<uint64_t> items{0}, busy_ns{0};
+    /** @brief if set, peak_rss_kb is the peak RSS when an item of the stage last ended */
+    bool count_memory = false;
+    std::atomic<uint64_t> peak_rss_kb{0};
+
+    StageStats(const char* name, uint32_t threads) : name(name), threads(threads) {}
+
+    /** @brief share of the wall-clock time its threads worked (not waiting on a queue) */
+    double utilization(double wall_seconds) const {
+        return wall_seconds > 0 ? busy_ns.load() / 1e9 / (wall_seconds * threads) : 0;
+    }
+    void print(std::ostream& out, double wall_seconds) const {
+        char line[128];
+        std::snprintf(line, sizeof(line), "stage %-8s: %u thread(s), %llu puzzles, busy %.3f s (%.0f%%)",
+                      name, threads, static_cast<unsigned long long>(items.load()), busy_ns.load() / 1e9,
+                      100 * utilization(wall_seconds));
+        out << line << "\n";
+    }
+};
+
+/** @brief nanoseconds from start to now */
+uint64_t ns_since(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+/** @brief counts one item of stage (unless stopped with false) and the time until stop() or the end of its scope */
+class StageTimer {
+public:
+    explicit StageTimer(StageStats& stage) : stage(&stage), start(std::chrono::steady_clock::now()) {}
+    ~StageTimer() { stop(); }
+
+    void stop(bool count_item = true){
+        if( stage == nullptr ){
+            return;
+        }
+        stage->items += count_item ? 1 : 0;
+        stage->busy_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        if( stage->count_memory ){
+            stage->peak_rss_kb = static_cast<uint64_t>(peak_memory_mb() * 1024);
+        }
+        stage = nullptr;
+    }
+
+private:
+    StageStats* stage;
+    std::chrono::steady_clock::time_point start;
+};
+
 int main(int argc, char *argv[]){
-    
-    if( argc != 4 ){
-        std::cerr << "invalid number of arguments" << std::endl;
-        std::cerr << "usage: ./sudoku_solver [Input Puzzle] [Output Puzzle] [MiniSatExe]" << std::endl;
+
+    Options options;
+    if( !parse_options(argc, argv, options) ){
+        std::cerr << "usage: ./sudoku_solver [--perf] [--time-limit=T] [--conflicts=N] [--propagations=N] [--retries=N] [--external] [--dimacs] [--cache=N] [--cache-file=F]" << std::endl;
+        std::cerr << "                       [--workers=N] [--solvers=N] [--threads=N] [--cubes=N] [--checkpoint=DIR] [--skeleton=DIR] [--check] [--no-hints] [--mem]" << std::endl;
+        std::cerr << "                       [--latency] [--slowest=N]" << std::endl;
+        std::cerr << "                       [Input Puzzle] [Output Puzzle] [MiniSatExe]" << std::endl;
+        std::cerr << "       ./sudoku_solver --verify [Input Puzzle] [Output Puzzle]" << std::endl;
+        std::cerr << "       ./sudoku_solver --write-skeleton=SIZE [Skeleton File]" << std::endl;
         return 1;
     }
 
-    std::string input_name = argv[1];
-    std::string output_name = argv[2];
-    std::string minisat_exe_name = argv[3];
+    if( options.write_skeleton != 0 ){
+        return SudokuSkeleton::write(options.write_skeleton, options.input_name) ? 0 : 1;
+    }
 
-    std::fstream input_file, output_file;
+    if( options.verify ){
+        return verify_batch(options.input_name, options.output_name, std::cout);
+    }
 
-    input_file.open(input_name, std::ios::in);
-    if( !input_file ){
+    std::signal(SIGINT, sigint_handler);
+    std::signal(SIGTERM, sigint_handler);
+    if( options.latency ){
+        std::signal(SIGUSR1, sigusr1_handler);
+    }
+
+    // a gzip input is decompressed on its own thread, a .gz output compressed, see compressed_stream.h
+    bool gzip_input = is_gzip_file(options.input_name);
+    DecompressingStreambuf inflated_input;
+    std::fstream plain_input;
+    if( gzip_input ? !inflated_input.open(options.input_name) : (plain_input.open(options.input_name, std::ios::in), !plain_input) ){
         std::cerr << "input file error" << std::endl;
         return 1;
     }
-    output_file.open(output_name, std::ios::out);
-    if( !output_file ){
+    std::istream input_file(gzip_input ? static_cast<std::streambuf*>(&inflated_input) : plain_input.rdbuf());
+
+    bool gzip_output = is_gzip_name(options.output_name);
+    CompressingStreambuf deflated_output;
+    std::fstream plain_output;
+    if( gzip_output ? !deflated_output.open(options.output_name) : (plain_output.open(options.output_name, std::ios::out), !plain_output) ){
         std::cerr << "output file error" << std::endl;
         return 1;
     }
+    std::ostream output_file(gzip_output ? static_cast<std::streambuf*>(&deflated_output) : plain_output.rdbuf());
+    StreamAnswerWriter answers(output_file);
+
+    // coordinator: each worker process maps its own range of the input, see shard_coordinator.h
+    if( options.workers > 1 ){
+        auto work = [&](const char* begin, const char* end, uint32_t skip, AnswerWriter& shard_answers){
+            MemoryStreambuf buffer(begin, end);
+            std::istream shard_input(&buffer);
+            return solve_batch(options, shard_input, shard_answers, skip);
+        };
+        if( !gzip_input ){
+            return run_shards(options.input_name, options.workers, work, answers, interrupted);
+        }
+        // shards are byte ranges of a mapped file: inflate the input to a temporary one first
+        std::string shard_name = "/tmp/sudoku_input." + std::to_string(getpid());
+        std::fstream shard_file(shard_name, std::ios::out | std::ios::binary);
+        shard_file << input_file.rdbuf();     // (failbit alone: the input was empty)
+        shard_file.close();
+        if( shard_file.bad() ){
+            std::cerr << "input file error: cannot write " << shard_name << std::endl;
+            std::remove(shard_name.c_str());
+            return 1;
+        }
+        int status = run_shards(shard_name, options.workers, work, answers, interrupted);
+        std::remove(shard_name.c_str());
+        return status;
+    }
+    return solve_batch(options, input_file, answers, 0);
+}
+
+/**
+ * @brief solve the puzzles of input_file but the first skip ones, answers in input order.
+ * returns the exit status: 0, or 1 if interrupted.
+ *
+ * a pipeline of stages on their own threads, with a BoundedQueue between each two:
+ *   parse (1.)  ->  encode (cache lookup, 2.)  ->  solve (3., 4., options.solvers threads)  ->  write (5., check, cache insert, 6.)
+ * cache hits go from encode straight to write. write puts the answers back in input order; at
+ * most PIPELINE_WINDOW puzzles are between parse and write, which bounds the memory of a batch.
+ */
+int solve_batch(const Options& options, std::istream& input_file, AnswerWriter& answers, uint32_t skip){
+    const uint64_t PIPELINE_WINDOW = 64 + 4 * options.solvers;
+    auto batch_start = std::chrono::steady_clock::now();
+
+    // perf: counters count the thread that opened them, so each stage opens its own; this one is write's
+    std::unique_ptr<PerfCounters> perf(options.perf ? new PerfCounters : nullptr);
+    PerfRegion perf_parse("parse"), perf_cache("cache"), perf_prepare("prepare"),
+               perf_minisat("minisat"), perf_decode("decode"), perf_cache_insert("cache");
+    std::vector<std::unique_ptr<SatBackend>> backends;
+    std::vector<PerfRegion> perf_solvers(options.solvers, PerfRegion("minisat"));
+    for( uint32_t i = 0; i < options.solvers; i++ ){
+        backends.emplace_back(new SatBackend);
+        backends.back()->interrupt = &interrupted;
+        backends.back()->checkpoint_dir = options.checkpoint_dir;
+    }
+    auto report_perf = [&](){
+        if( perf == nullptr ){
+            return;
+        }
+        std::cout << std::endl;
+        if( !perf->available() ){
+            std::cout << "perf: counters not available (perf_event_open failed)" << std::endl;
+            return;
+        }
+        SatBackend total;
+        for( uint32_t i = 0; i < options.solvers; i++ ){
+            perf_minisat.add(perf_solvers[i]);
+            total.decisions += backends[i]->decisions;
+            total.conflicts += backends[i]->conflicts;
+            total.cube_count += backends[i]->cube_count;
+            total.cubes_refuted += backends[i]->cubes_refuted;
+            total.cubes_stolen += backends[i]->cubes_stolen;
+            for( auto regions : {std::make_pair(&total.perf_eliminate, &backends[i]->perf_eliminate),
+                                 std::make_pair(&total.perf_simplifyDB, &backends[i]->perf_simplifyDB),
+                                 std::make_pair(&total.perf_propagate, &backends[i]->perf_propagate),
+                                 std::make_pair(&total.perf_analyze, &backends[i]->perf_analyze),
+                                 std::make_pair(&total.perf_reduceDB, &backends[i]->perf_reduceDB)} ){
+                regions.first->add(*regions.second);
+            }
+        }
+        perf_cache.add(perf_cache_insert);
+        // the MiniSat regions are part of "minisat" (an external MiniSat reports its own)
+        for( const PerfRegion* region : {&perf_parse, &perf_cache, &perf_prepare, &perf_minisat, &perf_decode,
+                                         &total.perf_eliminate, &total.perf_simplifyDB, &total.perf_propagate,
+                                         &total.perf_analyze, &total.perf_reduceDB} ){
+            region->print(stdout, *perf);
+        }
+        std::printf("perf search           : %llu decisions, %llu conflicts\n",
+                    static_cast<unsigned long long>(total.decisions), static_cast<unsigned long long>(total.conflicts));
+        if( total.cube_count > 0 ){
+            std::printf("perf cubes            : %llu, %llu refuted, %llu stolen\n", static_cast<unsigned long long>(total.cube_count),
+                        static_cast<unsigned long long>(total.cubes_refuted), static_cast<unsigned long long>(total.cubes_stolen));
+        }
+        std::printf("perf peak memory      : %.1f MB\n", peak_memory_mb());
+    };
+
+    SolutionCache cache(options.cache_size);
+    std::mutex cache_mutex;     // looked up by encode, filled by write
+    DiskSolutionCache disk_cache;
+    if( !options.cache_file.empty() ){
+        if( disk_cache.open(options.cache_file) ){
+            cache.disk = &disk_cache;
+        }
+        else{
+            std::cerr << "running without cache file" << std::endl;
+        }
+    }
+
+    // skeletons by box size, mapped when a puzzle of the size first comes (nullptr: none)
+    std::map<uint32_t, std::unique_ptr<SudokuSkeleton>> skeletons;
+    auto skeleton_for = [&](uint32_t size) -> const SudokuSkeleton* {
+        if( options.skeleton_dir.empty() ){
+            return nullptr;
+        }
+        auto found = skeletons.find(size);
+        if( found == skeletons.end() ){
+            std::unique_ptr<SudokuSkeleton> skeleton(new SudokuSkeleton);
+            if( !skeleton->open(SudokuSkeleton::file_name(options.skeleton_dir, size)) ){
+                std::cerr << "running without skeleton for size " << size << std::endl;
+                skeleton.reset();
+            }
+            found = skeletons.emplace(size, std::move(skeleton)).first;
+        }
+        return found->second.get();
+    };
+
+    BoundedQueue<JobPtr> parsed("parsed", 32), encoded("encoded", std::max(2u, options.solvers)),
+                         solved("solved", 32, options.solvers + 1);
+    StageStats stage_parse("parse", 1), stage_encode("encode", 1), stage_solve("solve", options.solvers), stage_write("write", 1);
+    std::atomic<uint64_t> encoder_bytes(0);     // largest PreparedPuzzle::memory_bytes()
+    uint64_t candidate_bytes = 0;               // largest PreparedPuzzle::encoder_bytes() (encode thread only)
+    uint32_t candidate_size = 0;                // the board size it was for
+    for( StageStats* stage : {&stage_parse, &stage_encode, &stage_solve, &stage_write} ){
+        stage->count_memory = options.mem;
+    }
+    for( auto& backend : backends ){
+        backend->count_memory = options.mem;
+    }
+    auto report_memory = [&](){
+        if( !options.mem ){
+            return;
+        }
+        std::cout << std::endl;
+        // peak RSS only grows: a stage that ends higher than the one before it is where it grew
+        for( const StageStats* stage : {&stage_parse, &stage_encode, &stage_solve, &stage_write} ){
+            std::printf("mem stage %-12s: peak RSS %.1f MB at the end of its last puzzle\n", stage->name, stage->peak_rss_kb / 1024.0);
+        }
+        SatMemory minisat;
+        for( const auto& backend : backends ){
+            minisat.add(backend->memory);
+        }
+        const double MB = 1024.0 * 1024.0;
+        std::printf("mem encoder           : %.2f MB (tables and candidates of a puzzle, largest)\n", encoder_bytes / MB);
+        if( candidate_bytes > 0 ){
+            std::printf("mem encoder candidates: %llu bytes for %ux%u (largest)\n",
+                        static_cast<unsigned long long>(candidate_bytes), candidate_size, candidate_size);
+        }
+        std::printf("mem minisat clauses   : %.2f MB\n", minisat.clauses / MB);
+        std::printf("mem minisat watches   : %.2f MB (binary clauses included)\n", minisat.watches / MB);
+        std::printf("mem minisat variables : %.2f MB\n", minisat.variables / MB);
+        std::printf("mem minisat other     : %.2f MB\n", minisat.other / MB);
+        std::printf("mem minisat preprocess: %.2f MB (freed before the search)\n", minisat.preprocessing / MB);
+        std::printf("mem minisat learnts   : %.2f MB (at their largest)\n", minisat.learnts / MB);
+        std::printf("mem minisat loaded    : %llu literals, %.1f bytes per literal\n",
+                    static_cast<unsigned long long>(minisat.literals), minisat.bytes_per_literal());
+    };
+    std::atomic<uint64_t> written(0);
+
+    // latency: one recorder per thread, merged by print_latency() while they may still be recorded into
+    LatencyRecorder latency_parse, latency_encode, latency_write;
+    std::vector<std::unique_ptr<LatencyRecorder>> latency_solvers;
+    std::vector<const LatencyRecorder*> latency_recorders{&latency_parse, &latency_encode, &latency_write};
+    for( uint32_t i = 0; i < options.solvers; i++ ){
+        latency_solvers.emplace_back(new LatencyRecorder);
+        latency_recorders.push_back(latency_solvers.back().get());
+    }
+    std::atomic<bool> batch_done(false);
+    std::thread latency_thread;
+    if( options.latency ){
+        latency_thread = std::thread([&](){
+            while( !batch_done ){
+                if( latency_requested.exchange(false) ){
+                    std::cout << "latency after " << written.load() << " puzzles:" << std::endl;
+                    print_latency(std::cout, latency_recorders);
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+        });
+    }
+    SlowestPuzzles slowest;
 
     // 1. parse sudoku puzzle
-    // sudoku puzzle use 1-based array, index 0 is ignored.
-    vector_2d<uint32_t> sudoku_puzzle;
+    std::thread parse_thread([&](){
+        std::unique_ptr<PerfCounters> counters(options.perf ? new PerfCounters : nullptr);
+        uint64_t index = 0;
+        while( !interrupted ){
+            for( uint32_t round = 0; index - written.load() >= PIPELINE_WINDOW && !interrupted; ){
+                backoff(round);
+            }
+            JobPtr job(new BatchJob);
+            job->started = std::chrono::steady_clock::now();
+            {
+                StageTimer timer(stage_parse);
+                PerfScope scope(counters.get(), perf_parse);
+                // sudoku puzzle use 1-based array, index 0 is ignored.
+                PuzzleRead read = read_puzzle(input_file, job->puzzle, job->size);
+                if( read == PuzzleRead::END ){
+                    timer.stop(false);
+                    break;
+                }
+                job->malformed = read == PuzzleRead::MALFORMED;
+            }
+            if( skip > 0 ){
+                skip--;
+                continue;
+            }
+            latency_parse.record(job->size, LatencyPhase::PARSE, ns_since(job->started));
+            job->index = index++;
+            parsed.push(job);
+        }
+        parsed.close();
+    });
 
-    std::string line;
-    std::getline(input_file, line);
-    std::vector<uint32_t> numbers = parse_line(line);
+    // cache lookup, then 2. to DS
+    std::thread encode_thread([&](){
+        std::unique_ptr<PerfCounters> counters(options.perf ? new PerfCounters : nullptr);
+        auto prepare = [&](auto* prepared){
+            {
+                PerfScope scope(counters.get(), perf_prepare);
+                prepared->solver.prepare();
+            }
+            prepared->solver.threads = options.threads;
+            return prepared;
+        };
 
-    uint32_t sudoku_size_square = numbers.size() - 1;
-    uint32_t sudoku_size = static_cast<uint32_t>( std::sqrt(static_cast<double>(sudoku_size_square)) );
-    
-    sudoku_puzzle.resize(sudoku_size_square+1);
-    sudoku_puzzle[0] = std::vector<uint32_t>(sudoku_size_square+1, 0); // ignore row 0
-    sudoku_puzzle[1] = numbers;
+        JobPtr job;
+        while( parsed.pop(job) ){
+            StageTimer timer(stage_encode);
+            auto encode_start = std::chrono::steady_clock::now();
+            if( cache.enabled() && !job->malformed ){
+                std::lock_guard<std::mutex> lock(cache_mutex);
+                PerfScope scope(counters.get(), perf_cache);
+                job->cached = cache.lookup(job->puzzle, job->size, job->canonical, job->solution);
+            }
+            if( job->cached == SolutionCache::Lookup::SOLVED ){
+                job->result = SatResult::SAT;
+            }
+            else if( job->cached == SolutionCache::Lookup::NO_SOLUTION ){
+                job->result = SatResult::UNSAT;
+            }
+            else if( !interrupted && !job->malformed ){
+                // with the solver for this size, picked once per puzzle
+                const auto& puzzle = job->puzzle;
+                switch( job->size ){
+                    case 3: job->prepared.reset(prepare(new PreparedSolver<FixedSudokuSolver<3>>(puzzle))); break;
+                    case 4: job->prepared.reset(prepare(new PreparedSolver<FixedSudokuSolver<4>>(puzzle))); break;
+                    case 5: job->prepared.reset(prepare(new PreparedSolver<FixedSudokuSolver<5>>(puzzle))); break;
+                    case 6: job->prepared.reset(prepare(new PreparedSolver<FixedSudokuSolver<6>>(puzzle))); break;
+                    default: {
+                        std::unique_ptr<PreparedSolver<SudokuSolver>> prepared(new PreparedSolver<SudokuSolver>(puzzle, job->size));
+                        prepared->solver.skeleton = skeleton_for(job->size);
+                        job->prepared.reset(prepare(prepared.release()));
+                        break;
+                    }
+                }
+                if( options.mem ){
+                    size_t bytes = job->prepared->memory_bytes();
+                    for( uint64_t largest = encoder_bytes; bytes > largest && !encoder_bytes.compare_exchange_weak(largest, bytes); ){
+                    }
+                    if( job->prepared->encoder_bytes() > candidate_bytes ){
+                        candidate_bytes = job->prepared->encoder_bytes();
+                        candidate_size = job->size * job->size;
+                    }
+                }
+                timer.stop();
+                latency_encode.record(job->size, LatencyPhase::ENCODE, ns_since(encode_start));
+                encoded.push(job);
+                continue;
+            }
+            timer.stop();
+            latency_encode.record(job->size, LatencyPhase::ENCODE, ns_since(encode_start));
+            solved.push(job);
+        }
+        encoded.close();
+        solved.close();
+    });
 
-    for( int i = 2; i <= sudoku_size_square; i++ ){
-        std::string line;
-        std::getline(input_file, line);
-        std::vector<uint32_t> numbers = parse_line(line);
-        sudoku_puzzle[i] = numbers;
+    // 4. SAT solver
+    std::vector<std::thread> solve_threads;
+    for( uint32_t i = 0; i < options.solvers; i++ ){
+        solve_threads.emplace_back([&, i](){
+            std::unique_ptr<PerfCounters> counters(options.perf ? new PerfCounters : nullptr);
+            SatBackend& backend = *backends[i];
+            backend.perf = counters.get();
+            JobPtr job;
+            while( encoded.pop(job) ){
+                {
+                    StageTimer timer(stage_solve);
+                    PerfScope scope(counters.get(), perf_solvers[i]);
+                    auto solve_start = std::chrono::steady_clock::now();
+                    job->result = job->prepared->solve(options, backend, job->model);
+                    latency_solvers[i]->record(job->size, LatencyPhase::SOLVE, ns_since(solve_start));
+                }
+                solved.push(job);
+            }
+            backend.perf = nullptr;
+            solved.close();
+        });
     }
 
+    // 5. decode, check, cache and 6. output, in input order
+    std::unique_ptr<SudokuVerifier> verifier;
+    uint32_t puzzle_count = 0, no_solution_count = 0, timeout_count = 0, invalid_count = 0, malformed_count = 0;
+    std::map<uint64_t, JobPtr> pending;
+    JobPtr next;
+    while( solved.pop(next) ){
+        uint64_t index = next->index;
+        pending.emplace(index, std::move(next));
+        for( auto found = pending.begin(); found != pending.end() && found->first == written.load(); found = pending.begin() ){
+            StageTimer timer(stage_write);
+            auto write_start = std::chrono::steady_clock::now();
+            JobPtr job = std::move(found->second);
+            pending.erase(found);
+            puzzle_count++;
+
 #ifdef DEBUG
-    print_sudoku_puzzle(sudoku_puzzle);
+            print_sudoku_puzzle(job->puzzle);
 #endif
 
-    // 2. to DS
-    SudokuSolver solver(sudoku_puzzle, sudoku_size);
-    solver.prepare();
+            if( job->prepared && job->result == SatResult::SAT ){
+                PerfScope scope(perf.get(), perf_decode);
+                job->prepared->decode(job->model, job->solution);
+            }
 
-    // 3. gen clauses + encode
-    solver.gen_clauses();
+            // checked: a wrong solution (of the solver or of the cache) is answered ERROR, and not cached
+            bool is_invalid = false;
+            if( options.check && job->result == SatResult::SAT ){
+                if( !verifier || verifier->box_size() != job->size ){
+                    verifier.reset(new SudokuVerifier(job->size));
+                }
+                std::string faults;
+                is_invalid = !verifier->verify(job->puzzle, job->solution, &faults);
+                if( is_invalid ){
+                    std::cerr << "puzzle " << puzzle_count << ": invalid solution: " << faults << std::endl;
+                    invalid_count++;
+                }
+            }
+            if( job->prepared && cache.enabled() && job->result != SatResult::UNKNOWN && !is_invalid ){
+                std::lock_guard<std::mutex> lock(cache_mutex);
+                PerfScope scope(perf.get(), perf_cache_insert);
+                cache.insert(job->canonical, job->result == SatResult::SAT ? &job->solution : nullptr);
+            }
 
-    // 4. SAT solver
-    std::string sat_input = solver.clause_list_to_DIMACS();
-    std::string sat_output;
-    bool is_satisfied;
+            // 6. output solution
+            std::ostringstream answer;
+            if( job->malformed ){
+                std::cerr << "puzzle " << puzzle_count << ": malformed, answered ERROR" << std::endl;
+                answer << "ERROR\n";
+                malformed_count++;
+            }
+            else if( is_invalid ){
+                answer << "ERROR\n";
+            }
+            else if( job->result == SatResult::SAT ){
+#ifdef DEBUG
+                print_sudoku_puzzle(job->solution);
+#endif
+                print_sudoku_solution(answer, job->solution);
+            }
+            else if( job->result == SatResult::UNSAT ){
+                std::cout << "NO" << std::endl;
+                answer << "NO\n";
+                no_solution_count++;
+            }
+            else if( job->result == SatResult::UNKNOWN ){
+                std::cout << (interrupted ? "INTERRUPTED" : "TIMEOUT") << std::endl;
+                answer << "TIMEOUT\n";
+                timeout_count++;
+            }
+            answers.write(answer.str());
+            latency_write.record(job->size, LatencyPhase::WRITE, ns_since(write_start));
+            uint64_t total_ns = ns_since(job->started);
+            latency_write.record(job->size, LatencyPhase::TOTAL, total_ns);
+            if( options.slowest > 0 && !job->malformed && (slowest.size() < options.slowest || total_ns > std::get<0>(slowest.top())) ){
+                slowest.emplace(total_ns, job->index, std::move(job->puzzle));
+                if( slowest.size() > options.slowest ){
+                    slowest.pop();
+                }
+            }
+            written++;
+        }
+    }
+    parse_thread.join();
+    encode_thread.join();
+    for( auto& thread : solve_threads ){
+        thread.join();
+    }
+    batch_done = true;
+    if( latency_thread.joinable() ){
+        latency_thread.join();
+    }
 
-    minisat_solver(minisat_exe_name, sat_input, sat_output, is_satisfied);
+    if( puzzle_count > 1 || interrupted || malformed_count > 0 ){
+        std::cout << "puzzles: " << puzzle_count << ", solved: " << puzzle_count - no_solution_count - timeout_count - invalid_count - malformed_count
+                  << ", no solution: " << no_solution_count << ", timeout: " << timeout_count;
+        if( options.check ){
+            std::cout << ", invalid: " << invalid_count;
+        }
+        if( malformed_count > 0 ){
+            std::cout << ", malformed: " << malformed_count;
+        }
+        char peak_memory[32];
+        std::snprintf(peak_memory, sizeof(peak_memory), "%.1f MB", peak_memory_mb());
+        std::cout << ", peak memory: " << peak_memory << std::endl;
+        if( cache.enabled() ){
+            cache.print_stats(std::cout);
+        }
 
-    if( !is_satisfied ){
-        std::cout << "NO";
-        return 0;
+        // the stage busiest for its threads is the bottleneck; the queue before it fills up
+        std::chrono::duration<double> wall = std::chrono::steady_clock::now() - batch_start;
+        const StageStats* bottleneck = nullptr;
+        for( const StageStats* stage : {&stage_parse, &stage_encode, &stage_solve, &stage_write} ){
+            stage->print(std::cout, wall.count());
+            if( bottleneck == nullptr || stage->utilization(wall.count()) > bottleneck->utilization(wall.count()) ){
+                bottleneck = stage;
+            }
+        }
+        parsed.print_stats(std::cout);
+        encoded.print_stats(std::cout);
+        solved.print_stats(std::cout);
+        std::cout << "bottleneck: " << bottleneck->name << std::endl;
     }
 
-    // 5. decode and get solution
-    std::vector<int32_t> sat_output_num = split_number(sat_output);
-    solver.decode(sat_output_num);
+    if( !options.checkpoint_dir.empty() ){
+        uint64_t resumed = 0;
+        for( const auto& backend : backends ){
+            resumed += backend->checkpoints_resumed;
+        }
+        std::cout << "checkpoints: " << resumed << " solve(s) resumed from " << options.checkpoint_dir << std::endl;
+    }
+    report_perf();
+    report_memory();
+    if( options.latency ){
+        std::cout << std::endl;
+        print_latency(std::cout, latency_recorders);
+    }
+    if( !slowest.empty() ){
+        write_slowest(options, slowest);
+    }
+    return interrupted ? 1 : 0;
+}
 
-#ifdef DEBUG
-    print_sudoku_puzzle(solver.puzzle);
-#endif
+bool parse_options(int argc, char *argv[], Options& options){
+    std::vector<std::string> args;
+    for( int i = 1; i < argc; i++ ){
+        std::string arg = argv[i];
+        auto value = [&](const std::string& prefix){ return arg.substr(prefix.size()); };
 
-    // 6. output solution
-    print_sudoku_solution(output_file, solver.puzzle);
+        try{
+            if( arg == "--perf" ){
+                options.perf = true;
+            }
+            else if( arg == "--mem" ){
+                options.mem = true;
+            }
+            else if( arg == "--latency" ){
+                options.latency = true;
+            }
+            else if( arg.compare(0, 10, "--slowest=") == 0 ){
+                options.slowest = std::stoul(value("--slowest="));
+            }
+            else if( arg == "--external" ){
+                options.external = true;
+            }
+            else if( arg == "--dimacs" ){
+                options.dimacs = true;
+            }
+            else if( arg == "--check" ){
+                options.check = true;
+            }
+            else if( arg == "--no-hints" ){
+                options.hints = false;
+            }
+            else if( arg == "--verify" ){
+                options.verify = true;
+            }
+            else if( arg.compare(0, 13, "--time-limit=") == 0 ){
+                options.time_limit = std::stod(value("--time-limit="));
+            }
+            else if( arg.compare(0, 12, "--conflicts=") == 0 ){
+                options.conflict_limit = std::stoll(value("--conflicts="));
+            }
+            else if( arg.compare(0, 15, "--propagations=") == 0 ){
+                options.propagation_limit = std::stoll(value("--propagations="));
+            }
+            else if( arg.compare(0, 10, "--retries=") == 0 ){
+                options.retries = std::stoi(value("--retries="));
+            }
+            else if( arg.compare(0, 8, "--cache=") == 0 ){
+                options.cache_size = std::stoul(value("--cache="));
+            }
+            else if( arg.compare(0, 13, "--cache-file=") == 0 ){
+                options.cache_file = value("--cache-file=");
+            }
+            else if( arg.compare(0, 10, "--workers=") == 0 ){
+                options.workers = std::stoul(value("--workers="));
+            }
+            else if( arg.compare(0, 10, "--solvers=") == 0 ){
+                options.solvers = std::stoul(value("--solvers="));
+            }
+            else if( arg.compare(0, 10, "--threads=") == 0 ){
+                options.threads = std::stoul(value("--threads="));
+            }
+            else if( arg.compare(0, 13, "--checkpoint=") == 0 ){
+                options.checkpoint_dir = value("--checkpoint=");
+            }
+            else if( arg.compare(0, 8, "--cubes=") == 0 ){
+                options.cubes = std::stoul(value("--cubes="));
+            }
+            else if( arg.compare(0, 11, "--skeleton=") == 0 ){
+                options.skeleton_dir = value("--skeleton=");
+            }
+            else if( arg.compare(0, 17, "--write-skeleton=") == 0 ){
+                options.write_skeleton = std::stoul(value("--write-skeleton="));
+            }
+            else if( arg.compare(0, 2, "--") == 0 ){
+                std::cerr << "unknown option: " << arg << std::endl;
+                return false;
+            }
+            else{
+                args.push_back(arg);
+            }
+        }
+        catch( const std::exception& ){
+            std::cerr << "invalid value: " << arg << std::endl;
+            return false;
+        }
+    }
+
+    if( options.write_skeleton != 0 ){
+        if( args.size() != 1 ){
+            std::cerr << "invalid number of arguments" << std::endl;
+            return false;
+        }
+        options.input_name = args[0];
+        return true;
+    }
+    if( args.size() != 2 && (args.size() != 3 || options.verify) ){
+        std::cerr << "invalid number of arguments" << std::endl;
+        return false;
+    }
+    if( options.retries < 0 || options.time_limit < 0 ){
+        std::cerr << "invalid value: negative retries or time limit" << std::endl;
+        return false;
+    }
+    options.input_name = args[0];
+    options.output_name = args[1];
+    if( args.size() == 3 ){
+        options.minisat_exe_name = args[2];
+    }
+    if( options.external && options.minisat_exe_name.empty() ){
+        std::cerr << "--external needs MiniSatExe" << std::endl;
+        return false;
+    }
+    if( options.solvers == 0 ){
+        std::cerr << "invalid value: --solvers=0" << std::endl;
+        return false;
+    }
+    if( options.threads == 0 ){
+        options.threads = std::max(1u, std::thread::hardware_concurrency() / (std::max(1u, options.workers) * options.solvers));
+    }
+    return true;
+}
+
+PuzzleRead read_puzzle(std::istream& input_file, vector_2d<uint32_t>& sudoku_puzzle, uint32_t& sudoku_size){
+    std::string line;
+    std::vector<uint32_t> numbers;
+    do{
+        if( !std::getline(input_file, line) ){
+            return PuzzleRead::END;
+        }
+        numbers = parse_line(line);
+    } while( numbers.size() <= 1 );
+
+    // the rest of a malformed puzzle, up to the blank line that ends it
+    auto skip_puzzle = [&](){
+        while( std::getline(input_file, line) && parse_line(line).size() > 1 ){
+        }
+        return PuzzleRead::MALFORMED;
+    };
+
+    uint32_t sudoku_size_square = numbers.size() - 1;
+    sudoku_size = static_cast<uint32_t>( std::lround(std::sqrt(static_cast<double>(sudoku_size_square))) );
+    if( sudoku_size * sudoku_size != sudoku_size_square ){
+        std::cerr << "puzzle format error: " << sudoku_size_square << " numbers in a row" << std::endl;
+        return skip_puzzle();
+    }
+
+    sudoku_puzzle.resize(sudoku_size_square+1);
+    sudoku_puzzle[0] = std::vector<uint32_t>(sudoku_size_square+1, 0); // ignore row 0
+    sudoku_puzzle[1] = numbers;
 
-    input_file.close();
-    output_file.close();
+    for( int i = 2; i <= sudoku_size_square; i++ ){
+        std::string line;
+        std::getline(input_file, line);
+        std::vector<uint32_t> numbers = parse_line(line);
+        if( numbers.size() != sudoku_size_square+1 ){
+            std::cerr << "puzzle format error: row " << i << std::endl;
+            // a blank line (or the end of input): the puzzle ended early, the next one starts after it
+            return numbers.size() <= 1 ? PuzzleRead::MALFORMED : skip_puzzle();
+        }
+        sudoku_puzzle[i] = numbers;
+    }
+    return PuzzleRead::OK;
+}
+
+void write_slowest(const Options& options, SlowestPuzzles& slowest){
+    std::string name = options.output_name + ".slowest";
+    if( options.workers > 1 ){
+        name += "." + std::to_string(getpid());
+    }
+    std::vector<SlowPuzzle> puzzles;
+    for( ; !slowest.empty(); slowest.pop() ){
+        puzzles.push_back(slowest.top());
+    }
+    std::reverse(puzzles.begin(), puzzles.end());
 
-    return 0;
+    std::fstream out(name, std::ios::out);
+    if( !out ){
+        std::cerr << "cannot write " << name << std::endl;
+        return;
+    }
+    std::cout << "slowest " << puzzles.size() << " puzzles, in " << name << ":";
+    for( size_t i = 0; i < puzzles.size(); i++ ){
+        if( i > 0 ){
+            out << "\n";
+        }
+        print_sudoku_solution(out, std::get<2>(puzzles[i]));
+        char entry[64];
+        std::snprintf(entry, sizeof(entry), " #%llu (%.3f s)", static_cast<unsigned long long>(std::get<1>(puzzles[i]) + 1),
+                      std::get<0>(puzzles[i]) / 1e9);
+        std::cout << entry;
+    }
+    std::cout << std::endl;
 }
 
-void print_sudoku_solution(std::fstream& output_file, const vector_2d<uint32_t>& puzzle){
+void print_sudoku_solution(std::ostream& output_file, const vector_2d<uint32_t>& puzzle){
     for( auto row_iter = std::next(puzzle.cbegin(), 1); row_iter != puzzle.cend(); row_iter++ ){
         for( auto col_iter = std::next(row_iter->cbegin(), 1); col_iter != row_iter->cend(); col_iter++ ){
             if( std::next(col_iter, 1) == row_iter->cend() ){
-                output_file << *col_iter << std::endl;
+                output_file << *col_iter << '\n';
             }
             else{
                 output_file << *col_iter << " ";
@@ -0,0 +1,233 @@
+/**
+ * @file sat_backend.cpp
+ * @brief run MiniSat in-process on the clauses of a generator, with limits and interruption.
+ */
+
+#include "sat_backend.h"
+#include "Solver.h"
+#include "CubeSolver.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+/** @brief Solver::addClause as a ClauseSink */
+class SolverSink : public ClauseSink {
+public:
+    SolverSink(Solver& S) : S(S) {}
+
+    void add_clause(const int32_t* literals, uint32_t count) override {
+        lits.clear();
+        for( uint32_t i = 0; i < count; i++ ){
+            Var var = std::abs(literals[i]) - 1;
+            while( var >= S.nVars() ){
+                S.newVar();
+            }
+            lits.push( (literals[i] > 0) ? Lit(var) : ~Lit(var) );
+        }
+        S.addClause(lits);
+        literal_count += count;
+    }
+
+    uint64_t literal_count = 0;
+
+private:
+    Solver& S;
+    vec<Lit> lits;
+};
+
+void SatMemory::add(const SatMemory& used){
+    literals = std::max(literals, used.literals);
+    clauses = std::max(clauses, used.clauses);
+    watches = std::max(watches, used.watches);
+    variables = std::max(variables, used.variables);
+    other = std::max(other, used.other);
+    preprocessing = std::max(preprocessing, used.preprocessing);
+    learnts = std::max(learnts, used.learnts);
+}
+
+namespace {
+
+/** @brief S set up from params, the clauses of gen_clauses loaded with hints; memory counted into used if asked */
+void load(Solver& S, SatBackend& backend, uint32_t var_num, const std::function<void(ClauseSink&)>& gen_clauses,
+          const SatHints& hints, const SatParams& params, SatMemory& used){
+    S.perf = backend.perf;
+    S.stop = backend.interrupt;
+    S.default_params.random_var_freq = params.random_var_freq;
+    if( params.restart_first > 0 ){
+        S.restart_first = params.restart_first;
+        S.resume_restarts = false;      // a retry's own restart interval, even on a resumed checkpoint
+    }
+    S.setRandomSeed(params.random_seed);
+    if( params.time_limit > 0 ){
+        S.setTimeBudget(params.time_limit);
+    }
+
+    while( S.nVars() < static_cast<int>(var_num) ){
+        S.newVar();
+    }
+    SolverSink sink(S);
+    gen_clauses(sink);
+    for( size_t var = 0; var < hints.activity.size() && var < static_cast<size_t>(S.nVars()); var++ ){
+        if( hints.activity[var] != 0 ){
+            S.setActivity(var, hints.activity[var]);
+        }
+    }
+    for( size_t var = 0; var < hints.polarity.size() && var < static_cast<size_t>(S.nVars()); var++ ){
+        if( hints.polarity[var] != 0 ){
+            S.setPolarity(var, hints.polarity[var] > 0 ? l_True : l_False);
+        }
+    }
+    if( backend.count_memory ){
+        SolverMemory loaded = S.memoryUsage();
+        used.literals = sink.literal_count;
+        used.clauses = loaded.clauses;
+        used.watches = loaded.watches;
+        used.variables = loaded.variables;
+        used.other = loaded.other;
+    }
+}
+
+/** @brief preprocess S if params say so */
+void preprocess(Solver& S, const SatParams& params){
+    if( params.preprocess ){
+        S.eliminate(params.time_limit > 0 ? params.time_limit / 2 : 10);
+    }
+}
+
+/** @brief the budgets of params from here on (after a checkpoint was loaded: its conflicts do not count) */
+void set_budgets(Solver& S, const SatParams& params){
+    if( params.conflict_limit >= 0 ){
+        S.setConfBudget(params.conflict_limit);
+    }
+    if( params.propagation_limit >= 0 ){
+        S.setPropBudget(params.propagation_limit);
+    }
+}
+
+/** @brief add the effort, memory and perf regions of a search of S (stats summed over its threads) to backend */
+void account(Solver& S, const SolverStats& stats, SatBackend& backend, SatMemory& used){
+    backend.decisions += stats.decisions;
+    backend.conflicts += stats.conflicts;
+    if( backend.count_memory ){
+        used.preprocessing = S.stats.simp_bytes;
+        used.learnts = stats.max_learnts_bytes;
+        backend.memory.add(used);
+    }
+    if( backend.perf != nullptr ){
+        backend.perf_eliminate.add(S.perf_eliminate);
+        backend.perf_simplifyDB.add(S.perf_simplifyDB);
+        backend.perf_propagate.add(S.perf_propagate);
+        backend.perf_analyze.add(S.perf_analyze);
+        backend.perf_reduceDB.add(S.perf_reduceDB);
+    }
+}
+
+/** @brief the result of S, and its model in the form of MiniSat's result file if SAT */
+SatResult finish(Solver& S, lbool result, std::vector<int32_t>& model){
+    if( result == l_Undef ){
+        return SatResult::UNKNOWN;
+    }
+    if( result == l_False ){
+        return SatResult::UNSAT;
+    }
+    model.clear();
+    for( int var = 0; var < S.nVars(); var++ ){
+        model.push_back( (S.model[var] == l_True) ? var+1 : -(var+1) );
+    }
+    return SatResult::SAT;
+}
+
+}
+
+SatResult SatBackend::solve(uint32_t var_num, const std::function<void(ClauseSink&)>& gen_clauses, const SatHints& hints,
+                            const SatParams& params, std::vector<int32_t>& model){
+    Solver S;
+    SatMemory used;
+    load(S, *this, var_num, gen_clauses, hints, params, used);
+    preprocess(S, params);
+
+    // the file of the problem: the same puzzle, encoded the same way, gets the same one
+    std::string checkpoint;
+    if( !checkpoint_dir.empty() && S.okay() ){
+        char name[32];
+        std::snprintf(name, sizeof(name), "/%016llx.ckpt", static_cast<unsigned long long>(S.problem_hash));
+        checkpoint = checkpoint_dir + name;
+        if( S.loadCheckpoint(checkpoint.c_str()) ){
+            checkpoints_resumed++;
+        }
+        S.checkpoint_file = checkpoint.c_str();
+        S.checkpoint_every = checkpoint_every;
+    }
+    set_budgets(S, params);
+    lbool result = S.okay() ? S.solveLimited() : l_False;
+    account(S, S.stats, *this, used);
+
+    if( !checkpoint.empty() ){
+        if( result == l_Undef ){
+            S.saveCheckpoint(checkpoint.c_str());
+        }
+        else{
+            std::remove(checkpoint.c_str());    // answered: nothing left to resume
+        }
+    }
+    return finish(S, result, model);
+}
+
+SatResult SatBackend::solve_cubes(uint32_t var_num, const std::function<void(ClauseSink&)>& gen_clauses, const SatHints& hints,
+                                  const std::vector<std::vector<int32_t>>& cubes, uint32_t threads, const SatParams& params,
+                                  std::vector<int32_t>& model){
+    Solver S;
+    SatMemory used;
+    load(S, *this, var_num, gen_clauses, hints, params, used);
+
+    // the variables of the cubes are assumed: elimination must keep them
+    vec<vec<Lit> > assumps(static_cast<int>(cubes.size()));
+    for( size_t i = 0; i < cubes.size(); i++ ){
+        for( int32_t literal : cubes[i] ){
+            Var var = std::abs(literal) - 1;
+            while( var >= S.nVars() ){
+                S.newVar();
+            }
+            S.setFrozen(var, true);
+            assumps[i].push( (literal > 0) ? Lit(var) : ~Lit(var) );
+        }
+    }
+    preprocess(S, params);
+    set_budgets(S, params);
+
+    lbool result = l_False;
+    if( S.okay() ){
+        CubeSolver C(S, std::max(1u, threads));
+        result = C.solveLimited(assumps);
+        account(S, C.stats, *this, used);
+        cube_count += assumps.size();
+        cubes_refuted += C.refuted;
+        cubes_stolen += C.stolen;
+    }
+    else{
+        account(S, S.stats, *this, used);
+    }
+    return finish(S, result, model);
+}
+
+void cross_cubes(const std::vector<std::vector<int32_t>>& cells, const std::function<bool(int32_t, int32_t)>& compatible,
+                 std::vector<std::vector<int32_t>>& cubes){
+    cubes.assign(1, std::vector<int32_t>());
+    for( const auto& cell : cells ){
+        std::vector<std::vector<int32_t>> longer;
+        longer.reserve(cubes.size() * cell.size());
+        for( const auto& cube : cubes ){
+            for( int32_t literal : cell ){
+                bool possible = std::all_of(cube.begin(), cube.end(), [&](int32_t other){ return compatible(other, literal); });
+                if( !possible ){
+                    continue;
+                }
+                longer.push_back(cube);
+                longer.back().push_back(literal);
+            }
+        }
+        cubes.swap(longer);
+    }
+}
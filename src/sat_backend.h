@@ -0,0 +1,115 @@
+/**
+ * @file sat_backend.h
+ * @brief run MiniSat in-process on the clauses of a generator, with limits and interruption.
+ *
+ * MiniSat's headers are only included by sat_backend.cpp: its global names (Clause, vec, ...)
+ * clash with ours, so nothing of it may leak through this header.
+ */
+
+#ifndef __SAT_BACKEND_H__
+#define __SAT_BACKEND_H__
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "clause_sink.h"
+#include "PerfCounters.h"
+
+enum class SatResult { SAT, UNSAT, UNKNOWN };
+
+/** @brief search parameters and limits of one solve, negative or 0 limits mean no limit */
+struct SatParams {
+    int64_t conflict_limit = -1;
+    int64_t propagation_limit = -1;
+    double time_limit = 0;          // seconds, wall-clock
+
+    bool preprocess = true;         // variable elimination + subsumption before search
+    double random_var_freq = 0.02;
+    double random_seed = 91648253;
+    double restart_first = 0;       // conflicts before the first restart, 0 for MiniSat's (100, or where a checkpoint left off)
+};
+
+/**
+ * @brief what the front end knows about the problem before the search, per variable (index var-1);
+ * an empty vector gives MiniSat's default.
+ */
+struct SatHints {
+    /** @brief a priority under the first bump of a conflict (1): it orders the variables no conflict has bumped yet */
+    static constexpr double TIE_BREAK = 1e-3;
+
+    /** @brief initial decision priority (VSIDS activity): higher first, 0 for none */
+    std::vector<double> activity;
+    /** @brief value tried first when the variable is decided: 1 true, -1 false, 0 MiniSat's default (false) */
+    std::vector<int8_t> polarity;
+};
+
+/** @brief bytes held by MiniSat, per part (see SolverMemory in Solver.h); add() keeps the largest of each */
+struct SatMemory {
+    uint64_t literals = 0;          // literals loaded, clauses of all sizes
+    uint64_t clauses = 0, watches = 0, variables = 0, other = 0;    // once loaded, before preprocessing
+    uint64_t preprocessing = 0;     // clause copies and occurrence lists of variable elimination, freed by it
+    uint64_t learnts = 0;           // learnt clauses at their largest during the search
+
+    /** @brief bytes per literal loaded, before preprocessing and learning */
+    double bytes_per_literal() const {
+        return literals > 0 ? double(clauses + watches + variables + other) / literals : 0;
+    }
+    void add(const SatMemory& other);
+};
+
+class SatBackend {
+public:
+    /** @brief when set (from another thread or a signal handler), a running solve() returns UNKNOWN */
+    const std::atomic<bool>* interrupt = nullptr;
+
+    /** @brief if set, MiniSat's hot functions are counted into the regions below (summed over all solves) */
+    PerfCounters* perf = nullptr;
+    PerfRegion perf_eliminate{"eliminate"}, perf_simplifyDB{"simplifyDB"}, perf_propagate{"propagate"},
+               perf_analyze{"analyze"}, perf_reduceDB{"reduceDB"};
+    /** @brief search effort, summed over all solves */
+    uint64_t decisions = 0, conflicts = 0;
+    /** @brief cubes of solve_cubes(): given, shown UNSAT, taken by a thread from the queue of another */
+    uint64_t cube_count = 0, cubes_refuted = 0, cubes_stolen = 0;
+    /**
+     * @brief if set, solve() saves what its search learnt to DIR/<problem hash>.ckpt every
+     * checkpoint_every seconds and when it gives up, and resumes from that file when it exists (a
+     * later attempt or run on the same puzzle); removed once answered. see Checkpoint.C
+     */
+    std::string checkpoint_dir;
+    double checkpoint_every = 60;
+    /** @brief solves that resumed from a checkpoint */
+    uint64_t checkpoints_resumed = 0;
+    /** @brief if set, memory is counted (walking MiniSat's clauses after loading), the largest solve kept */
+    bool count_memory = false;
+    SatMemory memory;
+
+    /**
+     * @brief solve var_num variables and the clauses gen_clauses pushes into its sink, straight into
+     * MiniSat's clause database, hints set before the search. on SAT, model gets one DIMACS literal
+     * per variable, true ones positive.
+     */
+    SatResult solve(uint32_t var_num, const std::function<void(ClauseSink&)>& gen_clauses, const SatHints& hints,
+                    const SatParams& params, std::vector<int32_t>& model);
+    /**
+     * @brief cube-and-conquer: solve() split into cubes, each cube (DIMACS literals, all of them
+     * true) solved as assumptions on one of threads solvers, each with a copy of the preprocessed
+     * problem (see CubeSolver.h). the cubes must cover every assignment: UNSAT once all of them
+     * are. the first SAT cube stops the others; limits apply to each thread, the time limit to all.
+     */
+    SatResult solve_cubes(uint32_t var_num, const std::function<void(ClauseSink&)>& gen_clauses, const SatHints& hints,
+                          const std::vector<std::vector<int32_t>>& cubes, uint32_t threads, const SatParams& params,
+                          std::vector<int32_t>& model);
+};
+
+/**
+ * @brief the cubes of giving each of cells one of its literals, in all ways: cells[i] holds the
+ * variables of which exactly one is true (the candidates of a cell), the first cell varies slowest.
+ * cubes with two literals that compatible() says cannot both be true are left out.
+ */
+void cross_cubes(const std::vector<std::vector<int32_t>>& cells, const std::function<bool(int32_t, int32_t)>& compatible,
+                 std::vector<std::vector<int32_t>>& cubes);
+
+#endif /* end of include guard: __SAT_BACKEND_H__ */
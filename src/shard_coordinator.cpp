@@ -0,0 +1,310 @@
+/**
+ * @file shard_coordinator.cpp
+ * @brief coordinator mode: split a puzzle file into byte ranges, solve each in a forked worker process, merge the answers.
+ */
+
+#include "shard_coordinator.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+/** @brief the frame length announcing that a worker answered its whole shard */
+const uint32_t DONE_FRAME = UINT32_MAX;
+
+struct Shard {
+    uint64_t begin, end;            // bytes of the input file
+
+    pid_t pid = -1;
+    int fd = -1;                    // read end of the worker's pipe, -1 when no worker runs
+    std::string buffer;             // bytes read, not yet a whole frame
+    bool done_frame = false;
+    bool finished = false;
+
+    std::vector<std::string> answers;
+    size_t written = 0;             // answers already passed on
+    size_t died_at = SIZE_MAX;      // answers given when the last worker died
+};
+
+/** @brief answers as frames on a pipe: length (uint32_t), then the bytes */
+class PipeAnswerWriter : public AnswerWriter {
+public:
+    explicit PipeAnswerWriter(int fd) : fd(fd) {}
+
+    void write(const std::string& answer) override {
+        uint32_t length = answer.size();
+        write_all(&length, sizeof(length));
+        write_all(answer.data(), answer.size());
+    }
+    void done(){
+        uint32_t length = DONE_FRAME;
+        write_all(&length, sizeof(length));
+    }
+
+private:
+    int fd;
+
+    void write_all(const void* data, size_t size){
+        const char* p = static_cast<const char*>(data);
+        while( size > 0 ){
+            ssize_t n = ::write(fd, p, size);
+            if( n < 0 && errno == EINTR ){
+                continue;
+            }
+            if( n <= 0 ){
+                _exit(3);   // the coordinator is gone
+            }
+            p += n;
+            size -= n;
+        }
+    }
+};
+
+/** @brief the position after the first line without digits at or after from (from is moved to a line start first), or size */
+uint64_t next_boundary(const char* data, uint64_t size, uint64_t from){
+    if( from == 0 || from >= size ){
+        return std::min(from, size);
+    }
+    const char* line = static_cast<const char*>(std::memchr(data + from - 1, '\n', size - from + 1));
+    while( line != nullptr && ++line < data + size ){
+        const char* line_end = static_cast<const char*>(std::memchr(line, '\n', data + size - line));
+        if( line_end == nullptr ){
+            break;
+        }
+        if( std::find_if(line, line_end, [](char c){ return c >= '0' && c <= '9'; }) == line_end ){
+            return line_end + 1 - data;
+        }
+        line = line_end;
+    }
+    return size;
+}
+
+/** @brief worker process: map the shard's range of input_fd, solve, send the answers on fd */
+int run_worker(int input_fd, const Shard& shard, uint32_t skip, int fd, const ShardWorker& work){
+    const uint64_t page = sysconf(_SC_PAGESIZE);
+    const uint64_t offset = shard.begin / page * page;
+    const size_t length = shard.end - offset;
+
+    void* map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, input_fd, offset);
+    if( map == MAP_FAILED ){
+        std::cerr << "shard: mmap failed: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    madvise(map, length, MADV_SEQUENTIAL);
+    const char* begin = static_cast<const char*>(map) + (shard.begin - offset);
+
+    PipeAnswerWriter answers(fd);
+    int status = work(begin, begin + (shard.end - shard.begin), skip, answers);
+    if( status == 0 ){
+        answers.done();
+    }
+    return status;
+}
+
+/** @brief fork a worker on the puzzles of shard not answered yet */
+void spawn(Shard& shard, const std::vector<Shard>& shards, int input_fd, const ShardWorker& work){
+    int fds[2];
+    if( pipe(fds) != 0 ){
+        std::cerr << "shard: pipe failed: " << std::strerror(errno) << std::endl;
+        std::exit(1);
+    }
+    std::cout.flush();
+    std::cerr.flush();
+
+    pid_t pid = fork();
+    if( pid < 0 ){
+        std::cerr << "shard: fork failed: " << std::strerror(errno) << std::endl;
+        std::exit(1);
+    }
+    if( pid == 0 ){
+        close(fds[0]);
+        for( const auto& other : shards ){
+            if( other.fd != -1 ){
+                close(other.fd);
+            }
+        }
+        int status = run_worker(input_fd, shard, shard.answers.size(), fds[1], work);
+        std::cout.flush();
+        std::cerr.flush();
+        _exit(status);
+    }
+
+    close(fds[1]);
+    shard.pid = pid;
+    shard.fd = fds[0];
+    shard.buffer.clear();
+    shard.done_frame = false;
+}
+
+/** @brief move the whole frames of shard's buffer to its answers */
+void take_frames(Shard& shard){
+    size_t pos = 0;
+    while( shard.buffer.size() - pos >= sizeof(uint32_t) ){
+        uint32_t length;
+        std::memcpy(&length, shard.buffer.data() + pos, sizeof(length));
+        if( length == DONE_FRAME ){
+            shard.done_frame = true;
+            pos += sizeof(length);
+            continue;
+        }
+        if( shard.buffer.size() - pos - sizeof(length) < length ){
+            break;
+        }
+        shard.answers.push_back(shard.buffer.substr(pos + sizeof(length), length));
+        pos += sizeof(length) + length;
+    }
+    shard.buffer.erase(0, pos);
+}
+
+} // namespace
+
+void StreamAnswerWriter::write(const std::string& answer){
+    if( !first ){
+        out << '\n';
+    }
+    first = false;
+    out << answer;
+}
+
+int run_shards(const std::string& input_name, uint32_t workers, const ShardWorker& work, AnswerWriter& answers,
+               const std::atomic<bool>& interrupted){
+    int input_fd = open(input_name.c_str(), O_RDONLY);
+    struct stat st;
+    if( input_fd == -1 || fstat(input_fd, &st) != 0 ){
+        std::cerr << "input file error" << std::endl;
+        return 1;
+    }
+    const uint64_t size = st.st_size;
+
+    // 1. shards of about size / workers bytes, ending after a separator line
+    std::vector<Shard> shards;
+    if( size > 0 ){
+        void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, input_fd, 0);
+        if( map == MAP_FAILED ){
+            std::cerr << "input file error: " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        uint64_t begin = 0;
+        for( uint32_t i = 1; i <= workers && begin < size; i++ ){
+            uint64_t end = next_boundary(static_cast<const char*>(map), size, std::max(begin, size * i / workers));
+            if( end > begin ){
+                Shard shard;
+                shard.begin = begin;
+                shard.end = end;
+                shards.push_back(shard);
+            }
+            begin = end;
+        }
+        munmap(map, size);
+    }
+
+    // 2. one worker per shard, collect their answers, restart the ones that die
+    for( auto& shard : shards ){
+        spawn(shard, shards, input_fd, work);
+    }
+
+    uint32_t restarts = 0, errors = 0;
+    bool forwarded = false;
+    size_t next_shard = 0;      // answers of the shards before it are written
+    while( true ){
+        std::vector<pollfd> fds;
+        std::vector<Shard*> polled;
+        for( auto& shard : shards ){
+            if( shard.fd != -1 ){
+                fds.push_back({shard.fd, POLLIN, 0});
+                polled.push_back(&shard);
+            }
+        }
+        if( fds.empty() ){
+            break;
+        }
+
+        if( poll(fds.data(), fds.size(), -1) < 0 ){
+            if( errno == EINTR && interrupted && !forwarded ){
+                // a kill of the coordinator alone, workers started from a terminal got the SIGINT already
+                for( const auto& shard : polled ){
+                    kill(shard->pid, SIGINT);
+                }
+                forwarded = true;
+            }
+            continue;
+        }
+
+        for( size_t i = 0; i < fds.size(); i++ ){
+            if( fds[i].revents == 0 ){
+                continue;
+            }
+            Shard& shard = *polled[i];
+            char buffer[65536];
+            ssize_t n = read(shard.fd, buffer, sizeof(buffer));
+            if( n < 0 && errno == EINTR ){
+                continue;
+            }
+            if( n > 0 ){
+                shard.buffer.append(buffer, n);
+                take_frames(shard);
+                continue;
+            }
+
+            // the worker closed its pipe: finished, interrupted or dead
+            close(shard.fd);
+            shard.fd = -1;
+            int status = 0;
+            while( waitpid(shard.pid, &status, 0) < 0 && errno == EINTR );
+
+            bool exited = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+            if( (exited && shard.done_frame) || interrupted ){
+                shard.finished = exited && shard.done_frame;
+                continue;
+            }
+            std::cerr << "shard " << (&shard - shards.data()) << ": worker ";
+            if( WIFSIGNALED(status) ){
+                std::cerr << "killed by signal " << WTERMSIG(status);
+            }
+            else{
+                std::cerr << "exited with status " << WEXITSTATUS(status);
+            }
+            std::cerr << " after " << shard.answers.size() << " answers, restarted" << std::endl;
+
+            if( shard.died_at == shard.answers.size() ){
+                // the second death on this puzzle: give it up
+                shard.answers.push_back("ERROR\n");
+                errors++;
+            }
+            shard.died_at = shard.answers.size();
+            restarts++;
+            spawn(shard, shards, input_fd, work);
+        }
+
+        // 3. answers in input order: everything of the first unfinished shard so far
+        for( ; next_shard < shards.size(); next_shard++ ){
+            Shard& shard = shards[next_shard];
+            for( ; shard.written < shard.answers.size(); shard.written++ ){
+                answers.write(shard.answers[shard.written]);
+            }
+            shard.answers.clear();
+            shard.answers.resize(shard.written);     // keep the count (the skip of a restart), drop the text
+            if( !shard.finished ){
+                break;
+            }
+        }
+    }
+    close(input_fd);
+
+    bool complete = std::all_of(shards.begin(), shards.end(), [](const Shard& shard){ return shard.finished; });
+    std::cout << "shards: " << shards.size() << ", restarts: " << restarts << ", errors: " << errors
+              << (complete ? "" : ", incomplete") << std::endl;
+    return complete ? 0 : 1;
+}
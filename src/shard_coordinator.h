@@ -0,0 +1,51 @@
+/**
+ * @file shard_coordinator.h
+ * @brief coordinator mode: split a puzzle file into byte ranges, solve each in a forked worker process, merge the answers.
+ *
+ * shards end at a line without digits (the separator of puzzles), so each holds whole puzzles.
+ * workers map their own range of the file and send one framed answer per puzzle through a pipe;
+ * the coordinator writes them out in input order as soon as all earlier shards are done.
+ */
+
+#ifndef __SHARD_COORDINATOR_H__
+#define __SHARD_COORDINATOR_H__
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+
+/** @brief receives the answer of each puzzle (solution grid, NO or TIMEOUT lines), in input order */
+class AnswerWriter {
+public:
+    virtual ~AnswerWriter() {}
+    virtual void write(const std::string& answer) = 0;
+};
+
+/** @brief answers separated by blank lines, the form of the output file */
+class StreamAnswerWriter : public AnswerWriter {
+public:
+    explicit StreamAnswerWriter(std::ostream& out) : out(out) {}
+    void write(const std::string& answer) override;
+
+private:
+    std::ostream& out;
+    bool first = true;
+};
+
+/** @brief solve the puzzles in [begin, end) but the first skip ones, return the exit status (0: all answered) */
+using ShardWorker = std::function<int(const char* begin, const char* end, uint32_t skip, AnswerWriter& answers)>;
+
+/**
+ * @brief solve the puzzles of input_name in workers processes, answers in input order.
+ *
+ * a worker that dies is started again on the puzzles of its shard it has not answered yet; the
+ * second time one dies on the same puzzle, that puzzle is answered ERROR and skipped. after
+ * interrupted is set no worker is started again. returns 0, or 1 if input_name cannot be read
+ * or not all puzzles were answered.
+ */
+int run_shards(const std::string& input_name, uint32_t workers, const ShardWorker& work, AnswerWriter& answers,
+               const std::atomic<bool>& interrupted);
+
+#endif /* end of include guard: __SHARD_COORDINATOR_H__ */
@@ -0,0 +1,307 @@
+/**
+ * @file solution_cache.cpp
+ * @brief in-memory LRU of solutions, keyed by a canonical form of the puzzle under the sudoku symmetries.
+ */
+
+#include "solution_cache.h"
+#include "disk_cache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+namespace {
+
+using Signature = std::vector<uint32_t>;
+
+/** @brief more orderings than this (per orientation) and the input order breaks the ties */
+const size_t MAX_ORDERS = 256;
+
+/** @brief every order of items (sorted) obtained by permuting runs of equal items, or only items if more than MAX_ORDERS */
+template <class Equal>
+std::vector<std::vector<uint32_t>> tie_permutations(const std::vector<uint32_t>& items, Equal equal){
+    std::vector<std::pair<size_t, size_t>> runs;
+    size_t count = 1;
+    for( size_t start = 0, end; start < items.size(); start = end ){
+        for( end = start+1; end < items.size() && equal(items[start], items[end]); end++ ){
+            count = std::min(count * (end-start+1), MAX_ORDERS+1);
+        }
+        if( end - start > 1 ){
+            runs.emplace_back(start, end);
+        }
+    }
+    if( count > MAX_ORDERS ){
+        return { items };
+    }
+
+    std::vector<std::vector<uint32_t>> orders = { items };
+    for( const auto& run : runs ){
+        std::vector<std::vector<uint32_t>> next;
+        for( auto order : orders ){
+            std::sort(order.begin() + run.first, order.begin() + run.second);
+            do{
+                next.push_back(order);
+            } while( std::next_permutation(order.begin() + run.first, order.begin() + run.second) );
+        }
+        orders.swap(next);
+    }
+    return orders;
+}
+
+/**
+ * @brief orders of the lines (rows or columns) of a board with bands of size lines:
+ * bands sorted by the signatures of their lines, lines sorted inside their band, ties in every order.
+ */
+std::vector<std::vector<uint32_t>> line_orders(const std::vector<Signature>& line_sig, uint32_t size){
+    auto line_less = [&](uint32_t a, uint32_t b){ return line_sig[a] < line_sig[b]; };
+    auto line_equal = [&](uint32_t a, uint32_t b){ return line_sig[a] == line_sig[b]; };
+
+    std::vector<std::vector<uint32_t>> band_lines(size);
+    std::vector<std::vector<Signature>> band_sig(size);
+    for( uint32_t band = 0; band < size; band++ ){
+        for( uint32_t line = band*size; line < (band+1)*size; line++ ){
+            band_lines[band].push_back(line);
+        }
+        std::stable_sort(band_lines[band].begin(), band_lines[band].end(), line_less);
+        for( const auto& line : band_lines[band] ){
+            band_sig[band].push_back(line_sig[line]);
+        }
+    }
+    std::vector<uint32_t> bands(size);
+    std::iota(bands.begin(), bands.end(), 0);
+    std::stable_sort(bands.begin(), bands.end(), [&](uint32_t a, uint32_t b){ return band_sig[a] < band_sig[b]; });
+
+    auto band_orders = tie_permutations(bands, [&](uint32_t a, uint32_t b){ return band_sig[a] == band_sig[b]; });
+    std::vector<std::vector<std::vector<uint32_t>>> line_choices(size);
+    size_t count = band_orders.size();
+    for( uint32_t band = 0; band < size; band++ ){
+        line_choices[band] = tie_permutations(band_lines[band], line_equal);
+        count = std::min(count * line_choices[band].size(), MAX_ORDERS+1);
+    }
+    if( count > MAX_ORDERS ){
+        std::vector<uint32_t> order;
+        for( const auto& band : bands ){
+            order.insert(order.end(), band_lines[band].begin(), band_lines[band].end());
+        }
+        return { order };
+    }
+
+    // every band order with every choice of line order inside each band
+    std::vector<std::vector<uint32_t>> orders;
+    for( const auto& band_order : band_orders ){
+        std::vector<size_t> choice(size, 0);
+        while( true ){
+            std::vector<uint32_t> order;
+            for( const auto& band : band_order ){
+                const auto& lines = line_choices[band][choice[band]];
+                order.insert(order.end(), lines.begin(), lines.end());
+            }
+            orders.push_back(order);
+
+            uint32_t band = 0;
+            for( ; band < size && ++choice[band] == line_choices[band].size(); band++ ){
+                choice[band] = 0;
+            }
+            if( band == size ){
+                break;
+            }
+        }
+    }
+    return orders;
+}
+
+} // namespace
+
+CanonicalKey SudokuTransform::apply(const vector_2d<uint32_t>& grid) const {
+    const uint32_t size_square = row_order.size();
+    CanonicalKey ret(size_square * size_square, 0);
+    for( uint32_t i = 0; i < size_square; i++ ){
+        for( uint32_t j = 0; j < size_square; j++ ){
+            uint32_t row = row_order[i], col = col_order[j];
+            uint32_t number = transpose ? grid[col+1][row+1] : grid[row+1][col+1];
+            ret[i*size_square + j] = digit_map[number];
+        }
+    }
+    return ret;
+}
+
+vector_2d<uint32_t> SudokuTransform::invert(const CanonicalKey& canonical) const {
+    const uint32_t size_square = row_order.size();
+    std::vector<uint32_t> inverse_map(size_square+1, 0);
+    for( uint32_t number = 1; number <= size_square; number++ ){
+        inverse_map[digit_map[number]] = number;
+    }
+
+    vector_2d<uint32_t> ret(size_square+1, std::vector<uint32_t>(size_square+1, 0));
+    for( uint32_t i = 0; i < size_square; i++ ){
+        for( uint32_t j = 0; j < size_square; j++ ){
+            uint32_t row = row_order[i], col = col_order[j];
+            uint32_t number = inverse_map[canonical[i*size_square + j]];
+            if( transpose ){
+                ret[col+1][row+1] = number;
+            }
+            else{
+                ret[row+1][col+1] = number;
+            }
+        }
+    }
+    return ret;
+}
+
+CanonicalKey canonical_form(const vector_2d<uint32_t>& puzzle, uint32_t size, SudokuTransform& transform){
+    const uint32_t size_square = size * size;
+    CanonicalKey best;
+
+    for( int transpose = 0; transpose < 2; transpose++ ){
+        auto at = [&](uint32_t row, uint32_t col){ return transpose ? puzzle[col+1][row+1] : puzzle[row+1][col+1]; };
+
+        // signature of a line: its givens, then the givens of the crossing lines at its givens
+        std::vector<uint32_t> row_count(size_square, 0), col_count(size_square, 0);
+        for( uint32_t row = 0; row < size_square; row++ ){
+            for( uint32_t col = 0; col < size_square; col++ ){
+                if( at(row, col) != 0 ){
+                    row_count[row]++;
+                    col_count[col]++;
+                }
+            }
+        }
+        std::vector<Signature> row_sig(size_square), col_sig(size_square);
+        for( uint32_t row = 0; row < size_square; row++ ){
+            row_sig[row].push_back(row_count[row]);
+            col_sig[row].push_back(col_count[row]);
+        }
+        for( uint32_t row = 0; row < size_square; row++ ){
+            for( uint32_t col = 0; col < size_square; col++ ){
+                if( at(row, col) != 0 ){
+                    row_sig[row].push_back(col_count[col]);
+                    col_sig[col].push_back(row_count[row]);
+                }
+            }
+        }
+        for( uint32_t line = 0; line < size_square; line++ ){
+            std::sort(row_sig[line].begin()+1, row_sig[line].end());
+            std::sort(col_sig[line].begin()+1, col_sig[line].end());
+        }
+
+        auto row_orders = line_orders(row_sig, size);
+        auto col_orders = line_orders(col_sig, size);
+        while( row_orders.size() * col_orders.size() > MAX_ORDERS ){
+            (row_orders.size() >= col_orders.size() ? row_orders : col_orders).resize(1);
+        }
+
+        // the smallest form over these orders, digits numbered in order of first appearance
+        for( const auto& row_order : row_orders ){
+            for( const auto& col_order : col_orders ){
+                CanonicalKey key(size_square * size_square, 0);
+                std::vector<uint32_t> digit_map(size_square+1, 0);
+                uint32_t next_digit = 1;
+                for( uint32_t i = 0; i < size_square; i++ ){
+                    for( uint32_t j = 0; j < size_square; j++ ){
+                        uint32_t number = at(row_order[i], col_order[j]);
+                        if( number != 0 && digit_map[number] == 0 ){
+                            digit_map[number] = next_digit++;
+                        }
+                        key[i*size_square + j] = digit_map[number];
+                    }
+                }
+                if( best.empty() || key < best ){
+                    best = key;
+                    transform.transpose = transpose;
+                    transform.row_order = row_order;
+                    transform.col_order = col_order;
+                    transform.digit_map = digit_map;
+                }
+            }
+        }
+    }
+
+    // digits missing from the puzzle: any order does, the solution maps back to a solution
+    uint32_t next_digit = size_square - std::count(transform.digit_map.begin()+1, transform.digit_map.end(), 0) + 1;
+    for( uint32_t number = 1; number <= size_square; number++ ){
+        if( transform.digit_map[number] == 0 ){
+            transform.digit_map[number] = next_digit++;
+        }
+    }
+    return best;
+}
+
+SolutionCache::Lookup SolutionCache::lookup(const vector_2d<uint32_t>& puzzle, uint32_t size, CanonicalPuzzle& canonical, vector_2d<uint32_t>& solution){
+    auto start = std::chrono::steady_clock::now();
+
+    // a given out of range: no solution, and no digit to relabel it to. not cached (empty key)
+    const uint32_t size_square = size * size;
+    for( uint32_t row = 1; row <= size_square; row++ ){
+        for( uint32_t col = 1; col <= size_square; col++ ){
+            if( puzzle[row][col] > size_square ){
+                canonical.key.clear();
+                cache_stats.lookups++;
+                return Lookup::MISS;
+            }
+        }
+    }
+
+    canonical.key = canonical_form(puzzle, size, canonical.transform);
+    Lookup ret = Lookup::MISS;
+    CanonicalKey cached_solution;
+    auto found = index.find(canonical.key);
+    if( found != index.end() ){
+        entries.splice(entries.begin(), entries, found->second);
+        cached_solution = found->second->second;
+        ret = Lookup::SOLVED;
+    }
+    else if( disk != nullptr && disk->lookup(canonical.key, cached_solution) ){
+        insert(canonical.key, cached_solution);
+        cache_stats.disk_hits++;
+        ret = Lookup::SOLVED;
+    }
+    if( ret != Lookup::MISS ){
+        if( cached_solution.empty() ){
+            ret = Lookup::NO_SOLUTION;
+        }
+        else{
+            solution = canonical.transform.invert(cached_solution);
+        }
+        cache_stats.hits++;
+    }
+
+    cache_stats.lookups++;
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    cache_stats.lookup_seconds += elapsed.count();
+    return ret;
+}
+
+void SolutionCache::insert(const CanonicalPuzzle& canonical, const vector_2d<uint32_t>* solution){
+    if( canonical.key.empty() ){
+        return;
+    }
+    CanonicalKey canonical_solution = (solution != nullptr) ? canonical.transform.apply(*solution) : CanonicalKey();
+    if( disk != nullptr ){
+        disk->insert(canonical.key, canonical_solution);
+    }
+    insert(canonical.key, canonical_solution);
+}
+
+void SolutionCache::insert(const CanonicalKey& key, const CanonicalKey& canonical_solution){
+    if( capacity == 0 || index.count(key) != 0 ){
+        return;
+    }
+    if( entries.size() >= capacity ){
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+    entries.emplace_front(key, canonical_solution);
+    index[key] = entries.begin();
+}
+
+void SolutionCache::print_stats(std::ostream& out) const {
+    out << "cache: " << cache_stats.lookups << " lookups, " << cache_stats.hits << " hits";
+    if( cache_stats.lookups > 0 ){
+        out << " (" << 100.0 * cache_stats.hits / cache_stats.lookups << " %";
+        if( disk != nullptr ){
+            out << ", " << cache_stats.disk_hits << " from file";
+        }
+        out << "), "
+            << 1e6 * cache_stats.lookup_seconds / cache_stats.lookups << " us per lookup";
+    }
+    out << std::endl;
+}
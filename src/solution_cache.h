@@ -0,0 +1,89 @@
+/**
+ * @file solution_cache.h
+ * @brief in-memory LRU of solutions, keyed by a canonical form of the puzzle under the sudoku symmetries.
+ *
+ * symmetries: transposition, band (stack) permutations, row (column) permutations inside a band
+ * (stack) and digit relabelling. the canonical form is the puzzle itself after one such transform,
+ * so equal forms always mean the cached solution maps back to a solution of the puzzle; a form that
+ * is not fully canonical (too many symmetric choices to try, see canonical_form()) only costs hits.
+ */
+
+#ifndef __SOLUTION_CACHE_H__
+#define __SOLUTION_CACHE_H__
+
+#include <cstdint>
+#include <list>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils.h"
+
+class DiskSolutionCache;
+
+/** @brief one cell per char, row by row, 0 for empty */
+using CanonicalKey = std::u16string;
+
+/** @brief transposition, then line orders, then digit relabelling; grids are 1-based as in main() */
+struct SudokuTransform {
+    bool transpose = false;
+    std::vector<uint32_t> row_order;    // row i of the canonical form is row row_order[i] (0-based)
+    std::vector<uint32_t> col_order;
+    std::vector<uint32_t> digit_map;    // [digit] => canonical digit, [0] = 0
+
+    CanonicalKey apply(const vector_2d<uint32_t>& grid) const;
+    vector_2d<uint32_t> invert(const CanonicalKey& canonical) const;
+};
+
+/**
+ * @brief canonical form of puzzle (box size size), transform gets the transform leading to it.
+ *
+ * lines are ordered by invariant signatures (givens in the line, givens in the crossing lines), the
+ * ties by trying every ordering of the tied lines and bands in both orientations and keeping the
+ * smallest form, digits are numbered in order of first appearance.
+ */
+CanonicalKey canonical_form(const vector_2d<uint32_t>& puzzle, uint32_t size, SudokuTransform& transform);
+
+/** @brief a puzzle as the cache sees it */
+struct CanonicalPuzzle {
+    CanonicalKey key;
+    SudokuTransform transform;
+};
+
+class SolutionCache {
+public:
+    enum class Lookup { MISS, SOLVED, NO_SOLUTION };
+
+    struct Stats {
+        uint64_t lookups = 0;
+        uint64_t hits = 0;
+        uint64_t disk_hits = 0;     // part of hits
+        double lookup_seconds = 0;  // canonical form included
+    };
+
+    explicit SolutionCache(size_t capacity) : capacity(capacity) {}
+
+    /** @brief if set, misses are looked up in this file and solutions are added to it */
+    DiskSolutionCache* disk = nullptr;
+
+    bool enabled() const { return capacity > 0 || disk != nullptr; }
+
+    /** @brief canonical gets the form of puzzle (for insert()), solution the cached one mapped back on a hit */
+    Lookup lookup(const vector_2d<uint32_t>& puzzle, uint32_t size, CanonicalPuzzle& canonical, vector_2d<uint32_t>& solution);
+    /** @brief remember the solution of a looked up puzzle, nullptr for no solution */
+    void insert(const CanonicalPuzzle& canonical, const vector_2d<uint32_t>* solution);
+    void insert(const CanonicalKey& key, const CanonicalKey& canonical_solution);
+
+    const Stats& stats() const { return cache_stats; }
+    void print_stats(std::ostream& out) const;
+
+private:
+    size_t capacity;
+    // most recently used first; the solution is in the canonical frame, empty for no solution
+    std::list<std::pair<CanonicalKey, CanonicalKey>> entries;
+    std::unordered_map<CanonicalKey, std::list<std::pair<CanonicalKey, CanonicalKey>>::iterator> index;
+    Stats cache_stats;
+};
+
+#endif /* end of include guard: __SOLUTION_CACHE_H__ */
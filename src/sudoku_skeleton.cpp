@@ -0,0 +1,137 @@
+/**
+ * @file sudoku_skeleton.cpp
+ * @brief the constraint skeleton of one board size, written once by --write-skeleton and mapped by every run.
+ */
+
+#include "sudoku_skeleton.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char MAGIC[8] = { 'S', 'U', 'D', 'O', 'K', 'U', 'K', '1' };
+
+} // namespace
+
+struct SudokuSkeleton::Header {
+    char magic[8];
+    uint32_t size;
+    uint32_t size_square;
+    uint32_t groups;
+    uint32_t group_members;
+};
+
+SudokuSkeleton::~SudokuSkeleton(){
+    if( map != nullptr ){
+        munmap(map, map_size);
+    }
+}
+
+std::string SudokuSkeleton::file_name(const std::string& dir, uint32_t size){
+    return dir + "/skeleton_" + std::to_string(size) + ".bin";
+}
+
+bool SudokuSkeleton::write(uint32_t size, const std::string& path){
+    const uint32_t S = size * size;
+    if( size < 2 || S > 0xffff ){
+        std::cerr << "skeleton: unsupported size " << size << std::endl;
+        return false;
+    }
+
+    std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if( !out ){
+        std::cerr << "skeleton: cannot open " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.size = size;
+    header.size_square = S;
+    header.groups = 4 * S * S;
+    header.group_members = S;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    auto put = [&out](const std::vector<uint32_t>& words){
+        out.write(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(uint32_t));
+    };
+
+    // cell_units, and the cells of each unit for the members below
+    std::vector<uint32_t> cell_units(3 * S * S);
+    std::vector<std::vector<uint32_t>> unit_cells(3 * S);
+    for( uint32_t cell = 0; cell < S * S; cell++ ){
+        uint32_t row = cell / S, col = cell % S;
+        uint32_t units[3] = { row, S + col, 2*S + size * (row / size) + col / size };
+        for( uint32_t i = 0; i < 3; i++ ){
+            cell_units[3 * cell + i] = units[i];
+            unit_cells[units[i]].push_back(cell);
+        }
+    }
+    put(cell_units);
+
+    // members, one group at a time: the cells, then each unit with each number
+    std::vector<uint32_t> group(S);
+    for( uint32_t cell = 0; cell < S * S; cell++ ){
+        for( uint32_t number = 1; number <= S; number++ ){
+            group[number-1] = cell * S + number-1;
+        }
+        put(group);
+    }
+    for( uint32_t unit = 0; unit < 3 * S; unit++ ){
+        for( uint32_t number = 1; number <= S; number++ ){
+            for( uint32_t i = 0; i < S; i++ ){
+                group[i] = unit_cells[unit][i] * S + number-1;
+            }
+            put(group);
+        }
+    }
+
+    out.close();
+    if( !out ){
+        std::cerr << "skeleton: cannot write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool SudokuSkeleton::open(const std::string& path){
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if( fd == -1 ){
+        std::cerr << "skeleton: cannot open " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    struct stat st;
+    if( fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(Header) ){
+        map_size = st.st_size;
+        map = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, 0);
+        if( map == MAP_FAILED ){
+            map = nullptr;
+        }
+    }
+    close(fd);
+
+    const Header* header = static_cast<const Header*>(map);
+    if( header == nullptr || std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ){
+        std::cerr << "skeleton: " << path << " is not a skeleton" << std::endl;
+        return false;
+    }
+    const uint64_t S = header->size_square;
+    if( S != uint64_t(header->size) * header->size || header->groups != 4 * S * S || header->group_members != S
+        || map_size != sizeof(Header) + (3 * S * S + 4 * S * S * S) * sizeof(uint32_t) ){
+        std::cerr << "skeleton: " << path << " is truncated or inconsistent" << std::endl;
+        return false;
+    }
+
+    size = header->size;
+    cell_units_table = reinterpret_cast<const uint32_t*>(header + 1);
+    members = cell_units_table + 3 * S * S;
+    return true;
+}
@@ -0,0 +1,63 @@
+/**
+ * @file sudoku_skeleton.h
+ * @brief the constraint skeleton of one board size, written once by --write-skeleton and mapped by
+ * every run: what SudokuSolver otherwise works out per puzzle from the board size alone.
+ *
+ * the skeleton is the CNF of the empty board: one exactly-one group per cell (its S numbers) and per
+ * unit and number (the S cells of the unit), S = size^2 numbers, variable cell * S + number-1. a
+ * puzzle specialises it: a group with a given in its cell, or its number given in its unit, is
+ * satisfied and skipped whole; the other groups keep the members that are candidates.
+ *
+ * file layout (native byte order, 32-bit words):
+ *   header       magic, size, S, groups, members per group (S)
+ *   cell_units   per cell: its row, col and block unit (units: S rows, S cols, S blocks, 0-based)
+ *   members      per group, S variables; groups in the order SudokuSolver generates them: the cells
+ *                row by row, then for each row, col and block unit its numbers 1 to S. group g
+ *                starts at g * S, its clauses (define, then pairwise or ladder at-most-one) come
+ *                after those of the groups before it.
+ *
+ * for S = 100 the file is 16 MB, shared between processes through the page cache.
+ */
+
+#ifndef __SUDOKU_SKELETON_H__
+#define __SUDOKU_SKELETON_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class SudokuSkeleton {
+public:
+    SudokuSkeleton() = default;
+    ~SudokuSkeleton();
+    SudokuSkeleton(const SudokuSkeleton&) = delete;
+    SudokuSkeleton& operator=(const SudokuSkeleton&) = delete;
+
+    /** @brief write the skeleton of boards with boxes of size x size cells to path; false (and a message on std::cerr) on error */
+    static bool write(uint32_t size, const std::string& path);
+    /** @brief the file name --skeleton=DIR looks for */
+    static std::string file_name(const std::string& dir, uint32_t size);
+
+    /** @brief map path read-only; false (and a message on std::cerr) if it is missing or not a skeleton */
+    bool open(const std::string& path);
+
+    uint32_t box_size() const { return size; }
+    uint32_t size_square() const { return size * size; }
+    uint32_t group_count() const { return 4 * size_square() * size_square(); }
+
+    /** @brief row, col and block unit of cell (0-based cell and units, blocks after the cols after the rows) */
+    const uint32_t* cell_units(uint32_t cell) const { return cell_units_table + 3 * cell; }
+    /** @brief the size_square() variables of group, each cell * S + number-1 */
+    const uint32_t* group_members(uint32_t group) const { return members + static_cast<size_t>(group) * size_square(); }
+
+private:
+    struct Header;
+
+    uint32_t size = 0;
+    const uint32_t* cell_units_table = nullptr;
+    const uint32_t* members = nullptr;
+    void* map = nullptr;
+    size_t map_size = 0;
+};
+
+#endif /* end of include guard: __SUDOKU_SKELETON_H__ */
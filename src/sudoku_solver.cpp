@@ -5,6 +5,54 @@
 
 #include "sudoku_solver.h"
 #include <iostream>
+#include <algorithm>
+
+void Encoder::number_candidates(){
+    uint32_t cells = size_square * size_square;
+    first_var.resize(cells + 1);
+    for( uint32_t cell = 0; cell < cells; cell++ ){
+        first_var[cell] = counter;
+        for( uint32_t word = 0; word < words; word++ ){
+            counter += __builtin_popcountll(candidates[cell * words + word]);
+        }
+    }
+    first_var[cells] = counter;
+}
+
+uint32_t Encoder::encode_cell_var(uint32_t cell, uint32_t number) const {
+    // rank of number among the candidates of its cell
+    const uint64_t* mask = &candidates[cell * words];
+    uint32_t word = (number-1) / 64;
+    uint32_t rank = __builtin_popcountll(mask[word] & ((uint64_t(1) << ((number-1) % 64)) - 1));
+    for( uint32_t w = 0; w < word; w++ ){
+        rank += __builtin_popcountll(mask[w]);
+    }
+    return first_var[cell] + rank;
+}
+
+SudokuVariable Encoder::decode_var(uint32_t var_num) const {
+    if( var_num == 0 || first_var.empty() || var_num >= first_var.back() ){
+        return SudokuVariable();    // auxiliary variable
+    }
+
+    // the last cell whose first variable <= var_num
+    uint32_t cell = std::upper_bound(first_var.begin(), first_var.end(), var_num) - first_var.begin() - 1;
+    uint32_t rank = var_num - first_var[cell];
+    const uint64_t* mask = &candidates[cell * words];
+    for( uint32_t word = 0; word < words; word++ ){
+        uint64_t bits = mask[word];
+        uint32_t count = __builtin_popcountll(bits);
+        if( rank < count ){
+            for( ; rank > 0; rank-- ){
+                bits &= bits - 1;
+            }
+            uint32_t number = word * 64 + __builtin_ctzll(bits) + 1;
+            return SudokuVariable(cell / size_square + 1, cell % size_square + 1, number);
+        }
+        rank -= count;
+    }
+    return SudokuVariable();
+}
 
 uint32_t SudokuSolver::count_block(uint32_t row, uint32_t col) const {
     /*
@@ -22,7 +70,79 @@ uint32_t SudokuSolver::count_block(uint32_t row, uint32_t col) const {
     return size * ((row-1)/size) + (col-1)/size + 1;
 }
 
-SudokuSolver::SudokuSolver(vector_2d<uint32_t> puzzle, uint32_t size) : puzzle(puzzle), size(size), encoder(size*size) {
+template <class F>
+void SudokuSolver::for_each_group(uint32_t task, F f) const {
+    std::vector<SudokuVariable> once_list;
+    uint32_t index = task % size_square() + 1;
+
+    switch( task / size_square() ){
+    case 0:
+        // cell => X[row][col][{num}] for col in cols, row = index
+        for( uint32_t row = index, col = 1; col <= size_square(); col++ ){
+            if( puzzle[row][col] == 0 ){
+                once_list.clear();
+                for( const auto& unuse_number : row_unuse_numbers[row] ){
+                    if( encoder.is_encoded(row, col, unuse_number) ){
+                        once_list.emplace_back(row, col, unuse_number);
+                    }
+                }
+
+                f(once_list);
+            }
+        }
+        break;
+
+    case 1:
+        // row => X[row][{col}][num], row = index
+        for( const auto& unuse_number : row_unuse_numbers[index] ){
+            once_list.clear();
+            
+            for( const auto& empty_cell_col : row_empty_cells[index] ){
+                if( !encoder.is_encoded(index, empty_cell_col, unuse_number) ){
+                    continue;
+                }
+                once_list.emplace_back(index, empty_cell_col, unuse_number);
+            }
+
+            f(once_list);
+        }
+        break;
+
+    case 2:
+        // col => X[{row}][col][num], col = index
+        for( const auto& unuse_number : col_unuse_numbers[index] ){
+            once_list.clear();
+            
+            for( const auto& empty_cell_row : col_empty_cells[index] ){
+                if( !encoder.is_encoded(empty_cell_row, index, unuse_number) ){
+                    continue;
+                }
+                once_list.emplace_back(empty_cell_row, index, unuse_number);
+            }
+
+            f(once_list);
+        }
+        break;
+
+    default:
+        // block => X[{row}][{col}][num], block = index
+        for( const auto& unuse_number : block_unuse_numbers[index] ){
+            once_list.clear();
+            
+            for( const auto& empty_cell : block_empty_cells[index] ){
+                if( !encoder.is_encoded(empty_cell.first, empty_cell.second, unuse_number) ){
+                    continue;
+                }
+                once_list.emplace_back(empty_cell.first, empty_cell.second, unuse_number);
+            }
+
+            f(once_list);
+        }
+        break;
+    }
+}
+
+SudokuSolver::SudokuSolver(vector_2d<uint32_t> puzzle, uint32_t size) : puzzle(puzzle), encoder(size*size), size(size) {
 
     row_numbers_use.resize(size_square()+1, std::vector<bool>(size_square()+1, false));
     row_empty_cells.resize(size_square()+1, std::vector<uint32_t>());
@@ -34,6 +154,11 @@ SudokuSolver::SudokuSolver(vector_2d<uint32_t> puzzle, uint32_t size) : puzzle(p
 
 /** @brief preprocess some data into data structure */
 void SudokuSolver::prepare(){
+    if( skeleton != nullptr ){
+        prepare_from_skeleton();
+        return;
+    }
+
     for( uint32_t row = 1; row <= size_square(); row++ ){
         const auto& line = puzzle[row];
 
@@ -47,14 +172,120 @@ void SudokuSolver::prepare(){
                 col_empty_cells[col].push_back(row);
                 block_empty_cells[block].push_back(std::pair<uint32_t, uint32_t>(row, col));
             }
+            else if( number > size_square() ){
+                givens_conflict = true;
+            }
             else{
-                // prefilled cell
+                // prefilled cell, the same number twice in a row, col or block: no solution
+                if( row_numbers_use[row][number] || col_numbers_use[col][number] || block_numbers_use[block][number] ){
+                    givens_conflict = true;
+                }
                 row_numbers_use[row][number] = true;
                 col_numbers_use[col][number] = true;
                 block_numbers_use[block][number] = true;
             }
         }
     }
+
+    if( givens_conflict ){
+        encoder.number_candidates();
+        task_aux.assign(task_count(), encoder.counter);
+        return;
+    }
+
+    gen_unuse_numbers();
+    const uint32_t S = size_square();
+
+    // candidates => only numbers unused in its row, col and block: the other variables would be
+    //   left free, the row, col and block clauses only see the candidates.
+    // group_size: the size of each exactly-one group, in the order of the tasks (see task_aux)
+    std::vector<uint32_t> group_size(task_count() * S, 0);
+    for( uint32_t row = 1; row <= size_square(); row++ ){
+        for( uint32_t col = 1; col <= size_square(); col++ ){
+            if( puzzle[row][col] == 0 ){
+                uint32_t block = count_block(row, col);
+                for( const auto& unuse_number : row_unuse_numbers[row] ){
+                    if( !col_numbers_use[col][unuse_number] && !block_numbers_use[block][unuse_number] ){
+                        encoder.add_candidate(row, col, unuse_number);
+                        group_size[(row-1) * S + col-1]++;
+                        group_size[(S + row-1) * S + unuse_number-1]++;
+                        group_size[(2*S + col-1) * S + unuse_number-1]++;
+                        group_size[(3*S + block-1) * S + unuse_number-1]++;
+                    }
+                }
+            }
+        }
+    }
+    encoder.number_candidates();
+    number_variables(group_size);
+}
+
+void SudokuSolver::prepare_from_skeleton(){
+    const uint32_t S = size_square();
+    const uint32_t words = encoder.words;
+
+    // numbers given in each unit, as masks like the candidates of a cell
+    unit_used.assign(3 * S * words, 0);
+    for( uint32_t cell = 0; cell < S * S; cell++ ){
+        uint32_t number = puzzle[cell / S + 1][cell % S + 1];
+        if( number == 0 ){
+            continue;
+        }
+        if( number > S ){
+            givens_conflict = true;
+            continue;
+        }
+        uint64_t bit = uint64_t(1) << ((number-1) % 64);
+        for( uint32_t i = 0; i < 3; i++ ){
+            uint64_t& used = unit_used[skeleton->cell_units(cell)[i] * words + (number-1) / 64];
+            if( used & bit ){
+                givens_conflict = true;     // the same number twice in a unit
+            }
+            used |= bit;
+        }
+    }
+    if( givens_conflict ){
+        encoder.number_candidates();
+        task_aux.assign(task_count(), encoder.counter);
+        return;
+    }
+
+    // candidates => numbers used in none of the units of the cell, a word at a time
+    std::vector<uint32_t> group_size(task_count() * S, 0);
+    for( uint32_t cell = 0; cell < S * S; cell++ ){
+        if( puzzle[cell / S + 1][cell % S + 1] != 0 ){
+            continue;
+        }
+        const uint32_t* units = skeleton->cell_units(cell);
+        for( uint32_t word = 0; word < words; word++ ){
+            uint64_t all = (word+1 < words || S % 64 == 0) ? ~uint64_t(0) : (uint64_t(1) << (S % 64)) - 1;
+            uint64_t free_numbers = all & ~(unit_used[units[0] * words + word] | unit_used[units[1] * words + word]
+                                            | unit_used[units[2] * words + word]);
+            encoder.candidates[cell * words + word] = free_numbers;
+
+            group_size[cell] += __builtin_popcountll(free_numbers);
+            for( ; free_numbers != 0; free_numbers &= free_numbers - 1 ){
+                uint32_t number = word * 64 + __builtin_ctzll(free_numbers) + 1;
+                for( uint32_t i = 0; i < 3; i++ ){
+                    group_size[(S + units[i]) * S + number-1]++;
+                }
+            }
+        }
+    }
+    encoder.number_candidates();
+    number_variables(group_size);
+}
+
+void SudokuSolver::number_variables(const std::vector<uint32_t>& group_size){
+    // auxiliary variables, task by task: the ladder of a group of k takes k-1
+    const uint32_t S = size_square();
+    task_aux.resize(task_count());
+    for( uint32_t task = 0; task < task_count(); task++ ){
+        task_aux[task] = encoder.counter;
+        for( uint32_t group = task * S; group < (task+1) * S; group++ ){
+            encoder.counter += exactly_one_aux(group_size[group]);
+        }
+    }
 }
 
 void SudokuSolver::gen_unuse_numbers(){
@@ -86,73 +317,116 @@ void SudokuSolver::gen_unuse_numbers(){
     }
 }
 
-void SudokuSolver::gen_clauses(){
+void SudokuSolver::gen_clauses(ClauseSink& sink){
     // process cell, row, col, and block constraint
 
-    gen_unuse_numbers();
-
-    // cell => X[row][col][{num}] for row in rows for col in cols
-    for( uint32_t row = 1; row <= size_square(); row++ ){
-        for( uint32_t col = 1; col <= size_square(); col++ ){
-            if( puzzle[row][col] == 0 ){
-                std::vector<SudokuVariable> once_list;
-                
-                for( const auto& unuse_number : row_unuse_numbers[row] ){
-                    once_list.emplace_back(row, col, unuse_number);
-                }
+    if( givens_conflict ){
+        sink.add_clause(nullptr, 0);    // the empty clause
+        return;
+    }
 
-                gen_define_unique_clause(once_list);
-            }
-        }    
-    }    
+    uint32_t task_threads = (size >= PARALLEL_MIN_SIZE) ? threads : 1;
+    generate_in_order(task_count(), task_threads, [this](uint32_t task, ClauseSink& task_sink){
+        gen_task(task, task_sink);
+    }, sink);
+}
 
-    // row => X[row][{col}][num] for row in rows
-    for( uint32_t row = 1; row <= size_square(); row++ ){
+void SudokuSolver::gen_task(uint32_t task, ClauseSink& sink) const {
+    uint32_t aux = task_aux[task];
+    if( skeleton == nullptr ){
+        for_each_group(task, [&](const std::vector<SudokuVariable>& once_list){
+            gen_define_unique_clause(once_list, sink, aux);
+        });
+        return;
+    }
 
-        for( const auto& unuse_number : row_unuse_numbers[row] ){
-            std::vector<SudokuVariable> once_list;
-            
-            for( const auto& empty_cell_col : row_empty_cells[row] ){
-                once_list.emplace_back(row, empty_cell_col, unuse_number);
+    // the groups of the skeleton, skipping the satisfied ones, with the members that are candidates
+    const uint32_t S = size_square();
+    std::vector<int32_t> vars;
+    vars.reserve(S);
+    for( uint32_t group = task * S; group < (task+1) * S; group++ ){
+        if( group < S * S ){
+            if( puzzle[group / S + 1][group % S + 1] != 0 ){
+                continue;       // given cell
+            }
+        }
+        else{
+            uint32_t unit = group / S - S, number = group % S + 1;
+            if( (unit_used[unit * encoder.words + (number-1) / 64] >> ((number-1) % 64)) & 1 ){
+                continue;       // number given in the unit
             }
-
-            gen_define_unique_clause(once_list);
         }
-        
-    }    
-
-    // col => X[{row}][col][num] for col in cols
-    for( uint32_t col = 1; col <= size_square(); col++ ){
 
-        for( const auto& unuse_number : col_unuse_numbers[col] ){
-            std::vector<SudokuVariable> once_list;
-            
-            for( const auto& empty_cell_row : col_empty_cells[col] ){
-                once_list.emplace_back(empty_cell_row, col, unuse_number);
+        vars.clear();
+        const uint32_t* members = skeleton->group_members(group);
+        for( uint32_t i = 0; i < S; i++ ){
+            uint32_t cell = members[i] / S, number = members[i] % S + 1;
+            if( encoder.is_candidate(cell, number) ){
+                vars.push_back(encoder.encode_cell_var(cell, number));
             }
+        }
+        gen_exactly_one(vars.data(), vars.size(), sink, aux);
+    }
+}
 
-            gen_define_unique_clause(once_list);
+void SudokuSolver::gen_hints(SatHints& hints) const {
+    hints.activity.clear();
+    hints.polarity.clear();
+    if( givens_conflict ){
+        return;
+    }
+
+    // the candidates of a cell are numbered one after the other, the auxiliary variables after them
+    hints.activity.assign(variable_count(), 0);
+    hints.polarity.assign(variable_count(), 0);
+    std::fill(hints.polarity.begin(), hints.polarity.begin() + encoder.candidate_count(), 1);
+    for( uint32_t cell = 0; cell + 1 < encoder.first_var.size(); cell++ ){
+        uint32_t count = encoder.first_var[cell+1] - encoder.first_var[cell];
+        for( uint32_t var = encoder.first_var[cell]; var < encoder.first_var[cell+1]; var++ ){
+            hints.activity[var-1] = SatHints::TIE_BREAK / count;
         }
-        
-    }    
+    }
+}
 
-    // block => X[{row}][{col}][num] for block in blocks
-    for( uint32_t block = 1; block <= size_square(); block++ ){
+void SudokuSolver::gen_cubes(uint32_t count, std::vector<std::vector<int32_t>>& cubes) const {
+    cubes.clear();
+    if( givens_conflict || count <= 1 ){
+        return;
+    }
 
-        for( const auto& unuse_number : block_unuse_numbers[block] ){
-            std::vector<SudokuVariable> once_list;
-            
-            for( const auto& empty_cell : block_empty_cells[block] ){
-                once_list.emplace_back(empty_cell.first, empty_cell.second, unuse_number);
-            }
+    // (candidates, cell) of the empty cells still open, fewest candidates first
+    std::vector<std::pair<uint32_t, uint32_t>> open_cells;
+    for( uint32_t cell = 0; cell + 1 < encoder.first_var.size(); cell++ ){
+        uint32_t candidates = encoder.first_var[cell+1] - encoder.first_var[cell];
+        if( candidates >= 2 ){
+            open_cells.emplace_back(candidates, cell);
+        }
+    }
+    std::sort(open_cells.begin(), open_cells.end());
 
-            gen_define_unique_clause(once_list);
+    std::vector<std::vector<int32_t>> cells;
+    uint64_t product = 1;
+    for( const auto& open : open_cells ){
+        if( product >= count ){
+            break;
+        }
+        cells.emplace_back();
+        for( uint32_t var = encoder.first_var[open.second]; var < encoder.first_var[open.second+1]; var++ ){
+            cells.back().push_back(var);
         }
-    }    
+        product *= open.first;
+    }
+
+    auto compatible = [this](int32_t a, int32_t b){
+        SudokuVariable x = encoder.decode_var(a), y = encoder.decode_var(b);
+        return x.number != y.number ||
+               (x.row != y.row && x.col != y.col && count_block(x.row, x.col) != count_block(y.row, y.col));
+    };
+    cross_cubes(cells, compatible, cubes);
 }
 
 // debug use
-void print_once_list(std::vector<SudokuVariable> once_list){
+void print_once_list(const std::vector<SudokuVariable>& once_list){
     for( const auto& var : once_list ){
         std::cout << "(" << var.row << ", " << var.col << ", " << var.number << "), ";
     }
@@ -160,52 +434,18 @@ void print_once_list(std::vector<SudokuVariable> once_list){
 }
 // debug use
 
-void SudokuSolver::gen_define_unique_clause(std::vector<SudokuVariable> once_list){
+void SudokuSolver::gen_define_unique_clause(const std::vector<SudokuVariable>& once_list, ClauseSink& sink, uint32_t& aux) const {
 
     // debug use
     // print_once_list(once_list);
 
-    std::vector<uint32_t> once_list_encode;
+    std::vector<int32_t> once_list_encode;
+    once_list_encode.reserve(once_list.size());
     for( const auto& var : once_list ){
-        if( !encoder.is_encoded(var) ){
-            encoder.add_variable_mapping(var);
-        }
-
         once_list_encode.push_back(encoder.encode_var(var));
     }
 
-    // define
-    Clause clause;
-    for( const auto& encode_var : once_list_encode ){
-        clause.emplace_back(encode_var);
-    }
-    clause_list.push_back(clause);
-    // use
-    for( auto it = once_list_encode.cbegin(); it != once_list_encode.cend(); it++ ){
-        for( auto it2 = std::next(it, 1); it2 != once_list_encode.cend(); it2++ ){
-            Clause clause = { {*it, false}, {*it2, false} };
-            clause_list.push_back(clause);
-        }
-    }
-}
-
-std::string SudokuSolver::clause_list_to_DIMACS(){
-    uint32_t var_num = encoder.counter - 1;
-    uint32_t clause_num = clause_list.size();
-
-    std::string ret;
-    ret = "p cnf " + std::to_string(var_num) + " " + std::to_string(clause_num) + "\n";
-    for( const auto& clause : clause_list ){
-        for( const auto& enc_var : clause ){
-            if( !enc_var.is_positive ){
-                ret += "-";
-            }
-            ret += std::to_string(enc_var.encode_num) + " ";
-        }
-        ret += "0\n";
-    }
-
-    return ret;
+    gen_exactly_one(once_list_encode.data(), once_list_encode.size(), sink, aux);
 }
 
 void SudokuSolver::decode(std::vector<int32_t> sat_output_num){
@@ -222,3 +462,12 @@ void SudokuSolver::decode(std::vector<int32_t> sat_output_num){
         }
     }
 }
+
+size_t SudokuSolver::memory_bytes() const {
+    return vector_bytes(puzzle)
+         + vector_bytes(row_numbers_use) + vector_bytes(row_empty_cells)
+         + vector_bytes(col_numbers_use) + vector_bytes(col_empty_cells)
+         + vector_bytes(block_numbers_use) + vector_bytes(block_empty_cells)
+         + vector_bytes(row_unuse_numbers) + vector_bytes(col_unuse_numbers) + vector_bytes(block_unuse_numbers)
+         + encoder.bytes() + vector_bytes(task_aux) + vector_bytes(unit_used);
+}
@@ -1,6 +1,32 @@
 /**
  * @file sudoku_solver.h
  * @brief solve sudoku problem by SAT. mapping sudoku puzzle to SAT problem, serialize to/deserialize from DIMACS CNF form.
+ *
+ * memory model, for a board of S = size^2 numbers (S^2 cells) with C candidates in all:
+ *
+ *   Encoder      S^2 * (8 * ceil(S/64) + 4) + 4 bytes, whatever the givens (exactly, see make check)
+ *   clauses      none held: gen_clauses() pushes each one into a ClauseSink as it is made. an
+ *                exactly-one of k variables is one clause of k literals, then k(k-1)/2 binary
+ *                clauses for k <= PAIRWISE_MAX, else the 3k-4 binary clauses (k-1 auxiliary
+ *                variables) of the ladder encoding. each candidate is in 4 groups (cell, row, col,
+ *                block): 30 to 40 literals per candidate in practice.
+ *   MiniSat      in-process, about 26 bytes per literal loaded, and about 36 more per literal while
+ *                eliminating (freed before the search); the search then adds learnt clauses as
+ *                conflicts go on (bound them with --conflicts=N).
+ *
+ * measured peak RSS on the boards of test/check_memory.sh (a solved grid, about half the cells
+ * given), at the end of encoding and in-process up to the first conflict (--conflicts=1). boards
+ * up to 36x36 go to FixedSudokuSolver. make check holds --mem to this table and the bytes per
+ * literal above, 20% over at most:
+ *
+ *   board     variables  clauses   literals   encoding   in-process
+ *   16x16       0.5 k      2.5 k     5.5 k      4.2 MB     4.3 MB
+ *   25x25       2.8 k     12 k      26 k        4.2 MB     5.2 MB
+ *   36x36        14 k      42 k      96 k        4.2 MB    10.9 MB
+ *   49x49        43 k     113 k     0.26 M       4.2 MB    23.6 MB
+ *   64x64       103 k     251 k     0.58 M       4.3 MB    49.0 MB
+ *   81x81       216 k     518 k     1.2 M        4.6 MB    97.0 MB
+ *   100x100     391 k     931 k     2.2 M        4.8 MB   171.9 MB
  */
 
 #ifndef __SUDOKU_SOLVER_H__
@@ -8,9 +34,11 @@
 
 #include <cstdint>
 #include <vector>
-#include <unordered_map>
-#include <iostream>
+#include <string>
 
+#include "clause_sink.h"
+#include "sat_backend.h"
+#include "sudoku_skeleton.h"
 #include "utils.h"
 
 struct SudokuVariable {
@@ -26,60 +54,55 @@ struct SudokuVariable {
 struct Encoder {
     // counter start from 1, 0 for no mapping
     // row, col, number use 1-based array
+    //
+    // variables for candidates only: the candidates of a cell are numbered one after the other,
+    // cell by cell, so a variable is the first variable of its cell plus the rank of its number.
+    // variables after the candidates are auxiliary (ladder encoding), unknown to decode_var().
+    // SudokuSolver::prepare() numbers them too, so that clause generation changes nothing here.
+
+    uint32_t size_square;
+    uint32_t words;                     // 64-bit words per cell, bit number-1
+    std::vector<uint64_t> candidates;   // [cell * words + word], cell = (row-1) * size_square + (col-1)
+    std::vector<uint32_t> first_var;    // [cell] => variable of its smallest candidate, [cells] => one past the last
+    uint32_t counter;                   // next free variable
+
+    Encoder(uint32_t size_square) : size_square(size_square), words((size_square + 63) / 64), counter(1) {
+        candidates.assign(size_square * size_square * words, 0);
+    }
 
-    // [row][col][number] => variable_number
-    vector_3d<uint32_t> to_number;
-    // [row][col][number] <= variable_number
-    std::unordered_map<uint32_t, SudokuVariable> to_variable;
-    uint32_t counter;
+    uint32_t cell_of(uint32_t row, uint32_t col) const { return (row-1) * size_square + (col-1); }
 
-    Encoder(uint32_t size_square) {
-        // std::cout << "size: " << size_square << std::endl;
-        to_number = vector_3d<uint32_t>(size_square+1, vector_2d<uint32_t>(size_square+1, std::vector<uint32_t>(size_square+1, 0)));
-        counter = 1;
+    /** @brief before number_candidates() */
+    void add_candidate(uint32_t row, uint32_t col, uint32_t number){
+        candidates[cell_of(row, col) * words + (number-1) / 64] |= uint64_t(1) << ((number-1) % 64);
     }
+    /** @brief number the candidates, once all are added */
+    void number_candidates();
+    uint32_t candidate_count() const { return first_var.back() - 1; }
 
-    bool is_encoded(uint32_t row, uint32_t col, uint32_t number){
-        return to_number[row][col][number] != 0;
-    }
-    bool is_encoded(SudokuVariable var){
-        return to_number[var.row][var.col][var.number] != 0;
-    }
-    uint32_t encode_var(uint32_t row, uint32_t col, uint32_t number){
-        return to_number[row][col][number];
+    bool is_candidate(uint32_t cell, uint32_t number) const {
+        return (candidates[cell * words + (number-1) / 64] >> ((number-1) % 64)) & 1;
     }
-    uint32_t encode_var(SudokuVariable var){
-        return to_number[var.row][var.col][var.number];
+    bool is_encoded(uint32_t row, uint32_t col, uint32_t number) const {
+        return is_candidate(cell_of(row, col), number);
     }
-    SudokuVariable decode_var(uint32_t var_num){
-        if( to_variable.count(var_num) == 0 ){
-            return SudokuVariable();
-        }
-        return to_variable[var_num];
+    bool is_encoded(SudokuVariable var) const {
+        return is_encoded(var.row, var.col, var.number);
     }
-
-    void add_variable_mapping(uint32_t row, uint32_t col, uint32_t number){
-        SudokuVariable var(row, col, number);
-        add_variable_mapping(var);
+    /** @brief variable of candidate number of cell (0-based, see cell_of()) */
+    uint32_t encode_cell_var(uint32_t cell, uint32_t number) const;
+    uint32_t encode_var(uint32_t row, uint32_t col, uint32_t number) const {
+        return encode_cell_var(cell_of(row, col), number);
     }
-
-    void add_variable_mapping(SudokuVariable var){
-        to_number[var.row][var.col][var.number] = counter;
-        to_variable[counter] = var;
-        counter++;
+    uint32_t encode_var(SudokuVariable var) const {
+        return encode_var(var.row, var.col, var.number);
     }
-};
+    SudokuVariable decode_var(uint32_t var_num) const;
 
-struct EncodeVariable {
-    bool is_positive;
-
-    uint32_t encode_num;
-
-    EncodeVariable(uint32_t encode_num, bool is_positive=true) : is_positive(is_positive), encode_num(encode_num) {}
+    /** @brief bytes held, after number_candidates() */
+    size_t bytes() const { return vector_bytes(candidates) + vector_bytes(first_var); }
 };
 
-using Clause = std::vector<EncodeVariable>;
-
 class SudokuSolver {
 public:
     vector_2d<uint32_t> puzzle;
@@ -96,7 +119,19 @@ public:
     vector_2d<uint32_t> block_unuse_numbers;
 
     Encoder encoder;
-    std::vector<Clause> clause_list;
+    /** @brief a number twice in a row, col or block (or out of range): no solution */
+    bool givens_conflict = false;
+
+    /**
+     * @brief clause generation is split into tasks: the cells of a row, then the rows, the cols and
+     * the blocks, one task each. task_aux[task] is the first auxiliary variable of task.
+     */
+    std::vector<uint32_t> task_aux;
+    uint32_t task_count() const { return 4 * size_square(); }
+    /** @brief threads generating the clauses of boards of size PARALLEL_MIN_SIZE and larger */
+    uint32_t threads = 1;
+    /** @brief if set (before prepare()), the groups come from it instead of the tables above */
+    const SudokuSkeleton* skeleton = nullptr;
 
     uint32_t size;
     uint32_t size_square() const { return size*size; }
@@ -104,17 +139,49 @@ public:
 
     SudokuSolver(vector_2d<uint32_t> puzzle, uint32_t size);
 
-    /** @brief preprocess some data into data structure */
+    /** @brief preprocess some data into data structure, number the candidates and auxiliary variables */
     void prepare();
     void gen_unuse_numbers();
-    void gen_clauses();
-    void gen_define_unique_clause(std::vector<SudokuVariable> once_list);
-
-    std::string clause_list_to_DIMACS();
+    /** @brief push every clause into sink in the same order each time, on several threads for large boards */
+    void gen_clauses(ClauseSink& sink);
+    /** @brief the clauses of one task, aux gets the auxiliary variables it takes */
+    void gen_task(uint32_t task, ClauseSink& sink) const;
+    /** @brief exactly one of once_list, aux is the next auxiliary variable */
+    void gen_define_unique_clause(const std::vector<SudokuVariable>& once_list, ClauseSink& sink, uint32_t& aux) const;
+
+    /** @brief candidates and auxiliary variables, after prepare() */
+    uint32_t variable_count() const { return encoder.counter - 1; }
+    /**
+     * @brief most constrained cell first: the candidates of a cell with k of them get priority
+     * TIE_BREAK / k, the auxiliary variables none. candidates are tried true first: that places a
+     * number and propagates through its cell, row, col and block, where false only strikes out
+     * one candidate. after prepare()
+     */
+    void gen_hints(SatHints& hints) const;
+    /**
+     * @brief cubes for SatBackend::solve_cubes(): the candidates of the most constrained empty cells
+     * (fewest candidates first) in all ways, cells added until that makes count cubes or more;
+     * ways with a number twice in a row, col or block are left out. none for count <= 1
+     */
+    void gen_cubes(uint32_t count, std::vector<std::vector<int32_t>>& cubes) const;
 
     void decode(std::vector<int32_t> sat_output_num);
 
+    /** @brief bytes held by the tables above and the encoder, after prepare() */
+    size_t memory_bytes() const;
+    /** @brief bytes held by the encoder alone, the Encoder line of the memory model above */
+    size_t encoder_bytes() const { return encoder.bytes(); }
+
 private:
-    /* data */
+    /** @brief numbers given in each unit (skeleton units), encoder.words words each */
+    std::vector<uint64_t> unit_used;
+
+    void prepare_from_skeleton();
+    /** @brief task_aux and the auxiliary variables from the size of each group, in task order */
+    void number_variables(const std::vector<uint32_t>& group_size);
+    /** @brief f(once_list) for each exactly-one group of task */
+    template <class F>
+    void for_each_group(uint32_t task, F f) const;
 };
+
 #endif /* end of include guard: __SUDOKU_SOLVER_H__ */
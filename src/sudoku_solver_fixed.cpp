@@ -0,0 +1,269 @@
+/**
+ * @file sudoku_solver_fixed.cpp
+ * @brief SudokuSolver specialised on the box size at compile time, instantiated for box sizes 3 to 6.
+ */
+
+#include "sudoku_solver_fixed.h"
+#include <algorithm>
+#include <iostream>
+#include <map>
+
+namespace {
+
+/** @brief cells of each unit and units of each cell of a board with N x N boxes */
+template <uint32_t N>
+struct SudokuTables {
+    uint16_t unit_cells[3*N*N][N*N];
+    uint16_t cell_units[N*N*N*N][3];
+};
+
+template <uint32_t N>
+constexpr SudokuTables<N> make_sudoku_tables(){
+    SudokuTables<N> tables{};
+    for( uint32_t row = 0; row < N*N; row++ ){
+        for( uint32_t col = 0; col < N*N; col++ ){
+            uint32_t cell = row*N*N + col;
+            uint32_t block = N*(row/N) + col/N;
+
+            tables.unit_cells[row][col] = cell;
+            tables.unit_cells[N*N + col][row] = cell;
+            tables.unit_cells[2*N*N + block][N*(row%N) + col%N] = cell;
+
+            tables.cell_units[cell][0] = row;
+            tables.cell_units[cell][1] = N*N + col;
+            tables.cell_units[cell][2] = 2*N*N + block;
+        }
+    }
+    return tables;
+}
+
+template <uint32_t N>
+constexpr SudokuTables<N> sudoku_tables = make_sudoku_tables<N>();
+
+/** @brief mask of numbers 1 to count */
+template <class Mask>
+constexpr Mask first_numbers(uint32_t count) { return (count >= 8*sizeof(Mask)) ? ~Mask(0) : (Mask(1) << count) - 1; }
+
+inline uint32_t popcount(uint32_t mask) { return __builtin_popcount(mask); }
+inline uint32_t popcount(uint64_t mask) { return __builtin_popcountll(mask); }
+inline uint32_t lowest_bit(uint32_t mask) { return __builtin_ctz(mask); }
+inline uint32_t lowest_bit(uint64_t mask) { return __builtin_ctzll(mask); }
+
+} // namespace
+
+template <uint32_t N>
+FixedSudokuSolver<N>::FixedSudokuSolver(const vector_2d<uint32_t>& puzzle) : puzzle(puzzle) {
+    for( uint32_t row = 1; row <= SIZE_SQUARE; row++ ){
+        for( uint32_t col = 1; col <= SIZE_SQUARE; col++ ){
+            uint32_t number = puzzle[row][col];
+            if( number > SIZE_SQUARE ){
+                givens_conflict = true;
+                number = 0;
+            }
+            grid[(row-1)*SIZE_SQUARE + (col-1)] = number;
+        }
+    }
+}
+
+template <uint32_t N>
+void FixedSudokuSolver<N>::prepare(){
+    const auto& tables = sudoku_tables<N>;
+    const NumberMask all_numbers = first_numbers<NumberMask>(SIZE_SQUARE);
+
+    unit_used.fill(0);
+    for( uint32_t cell = 0; cell < CELLS; cell++ ){
+        if( grid[cell] == 0 ){
+            continue;
+        }
+        NumberMask bit = NumberMask(1) << (grid[cell]-1);
+        for( uint32_t unit : tables.cell_units[cell] ){
+            if( unit_used[unit] & bit ){
+                givens_conflict = true;
+            }
+            unit_used[unit] |= bit;
+        }
+    }
+
+    var_num = 0;
+    for( uint32_t cell = 0; cell < CELLS; cell++ ){
+        const auto& units = tables.cell_units[cell];
+        NumberMask used = unit_used[units[0]] | unit_used[units[1]] | unit_used[units[2]];
+
+        candidates[cell] = (grid[cell] == 0) ? all_numbers & ~used : 0;
+        var_base[cell] = var_num + 1;
+        var_num += popcount(candidates[cell]);
+    }
+
+    // auxiliary variables after the candidates, task by task as gen_task() takes them
+    for( uint32_t task = 0; task < SIZE_SQUARE; task++ ){
+        task_aux[task] = var_num + 1;
+        for( uint32_t cell = task * SIZE_SQUARE; cell < (task+1) * SIZE_SQUARE; cell++ ){
+            var_num += exactly_one_aux(popcount(candidates[cell]));
+        }
+    }
+    for( uint32_t unit = 0; unit < UNITS; unit++ ){
+        std::array<uint32_t, SIZE_SQUARE> cells_of_number{};
+        for( uint32_t cell : tables.unit_cells[unit] ){
+            for( NumberMask numbers = candidates[cell]; numbers != 0; numbers &= numbers-1 ){
+                cells_of_number[lowest_bit(numbers)]++;
+            }
+        }
+        task_aux[SIZE_SQUARE + unit] = var_num + 1;
+        for( uint32_t count : cells_of_number ){
+            var_num += exactly_one_aux(count);
+        }
+    }
+}
+
+template <uint32_t N>
+int32_t FixedSudokuSolver<N>::variable(uint32_t cell, uint32_t number) const {
+    return var_base[cell] + popcount(candidates[cell] & first_numbers<NumberMask>(number-1));
+}
+
+template <uint32_t N>
+void FixedSudokuSolver<N>::gen_clauses(ClauseSink& sink){
+    if( givens_conflict ){
+        sink.add_clause(nullptr, 0);    // the empty clause
+        return;
+    }
+
+    // tasks: the cells of each row, then the units
+    uint32_t task_threads = (N >= PARALLEL_MIN_SIZE) ? threads : 1;
+    generate_in_order(SIZE_SQUARE + UNITS, task_threads, [this](uint32_t task, ClauseSink& task_sink){
+        gen_task(task, task_sink);
+    }, sink);
+}
+
+template <uint32_t N>
+void FixedSudokuSolver<N>::gen_task(uint32_t task, ClauseSink& sink) const {
+    const auto& tables = sudoku_tables<N>;
+    std::array<int32_t, SIZE_SQUARE> vars;
+    uint32_t aux = task_aux[task];
+
+    if( task < SIZE_SQUARE ){
+        // cell => exactly one of its candidates, their variables are consecutive
+        for( uint32_t cell = task * SIZE_SQUARE; cell < (task+1) * SIZE_SQUARE; cell++ ){
+            if( grid[cell] != 0 ){
+                continue;
+            }
+            uint32_t count = popcount(candidates[cell]);
+            for( uint32_t i = 0; i < count; i++ ){
+                vars[i] = var_base[cell] + i;
+            }
+            gen_exactly_one(vars.data(), count, sink, aux);
+        }
+        return;
+    }
+
+    // row, col, block => each number the unit misses in exactly one of the cells that can take it
+    const NumberMask all_numbers = first_numbers<NumberMask>(SIZE_SQUARE);
+    uint32_t unit = task - SIZE_SQUARE;
+    for( NumberMask missing = all_numbers & ~unit_used[unit]; missing != 0; missing &= missing-1 ){
+        uint32_t number = lowest_bit(missing) + 1;
+
+        uint32_t count = 0;
+        for( uint32_t cell : tables.unit_cells[unit] ){
+            if( (candidates[cell] >> (number-1)) & 1 ){
+                vars[count++] = variable(cell, number);
+            }
+        }
+        gen_exactly_one(vars.data(), count, sink, aux);
+    }
+}
+
+template <uint32_t N>
+void FixedSudokuSolver<N>::gen_hints(SatHints& hints) const {
+    hints.activity.clear();
+    hints.polarity.clear();
+    if( givens_conflict ){
+        return;
+    }
+
+    // the candidates come first, then the auxiliary variables (no priority, MiniSat's polarity)
+    hints.activity.assign(var_num, 0);
+    hints.polarity.assign(var_num, 0);
+    std::fill(hints.polarity.begin(), hints.polarity.begin() + (task_aux[0] - 1), 1);
+    for( uint32_t cell = 0; cell < CELLS; cell++ ){
+        uint32_t count = popcount(candidates[cell]);
+        for( uint32_t i = 0; i < count; i++ ){
+            hints.activity[var_base[cell] + i - 1] = SatHints::TIE_BREAK / count;
+        }
+    }
+}
+
+template <uint32_t N>
+void FixedSudokuSolver<N>::gen_cubes(uint32_t count, std::vector<std::vector<int32_t>>& cubes) const {
+    cubes.clear();
+    if( givens_conflict || count <= 1 ){
+        return;
+    }
+
+    std::vector<std::pair<uint32_t, uint32_t>> open_cells;     // (candidates, cell), fewest candidates first
+    for( uint32_t cell = 0; cell < CELLS; cell++ ){
+        uint32_t candidate_count = popcount(candidates[cell]);
+        if( candidate_count >= 2 ){
+            open_cells.emplace_back(candidate_count, cell);
+        }
+    }
+    std::sort(open_cells.begin(), open_cells.end());
+
+    std::vector<std::vector<int32_t>> cells;
+    std::map<int32_t, std::pair<uint32_t, uint32_t>> placed;    // variable => (cell, number)
+    uint64_t product = 1;
+    for( const auto& open : open_cells ){
+        if( product >= count ){
+            break;
+        }
+        uint32_t cell = open.second;
+        cells.emplace_back();
+        int32_t var = var_base[cell];
+        for( NumberMask numbers = candidates[cell]; numbers != 0; numbers &= numbers-1, var++ ){
+            cells.back().push_back(var);
+            placed[var] = std::make_pair(cell, lowest_bit(numbers) + 1);
+        }
+        product *= open.first;
+    }
+
+    auto compatible = [&placed](int32_t a, int32_t b){
+        const auto& x = placed.at(a);
+        const auto& y = placed.at(b);
+        if( x.second != y.second ){
+            return true;
+        }
+        const auto& x_units = sudoku_tables<N>.cell_units[x.first];
+        const auto& y_units = sudoku_tables<N>.cell_units[y.first];
+        return x_units[0] != y_units[0] && x_units[1] != y_units[1] && x_units[2] != y_units[2];
+    };
+    cross_cubes(cells, compatible, cubes);
+}
+
+template <uint32_t N>
+void FixedSudokuSolver<N>::decode(std::vector<int32_t> sat_output_num){
+    std::vector<bool> is_true(var_num+1, false);
+    for( const auto& number : sat_output_num ){
+        if( number > 0 && static_cast<uint32_t>(number) <= var_num ){
+            is_true[number] = true;
+        }
+    }
+
+    for( uint32_t cell = 0; cell < CELLS; cell++ ){
+        uint32_t row = cell / SIZE_SQUARE + 1, col = cell % SIZE_SQUARE + 1;
+        uint32_t var = var_base[cell];
+        for( NumberMask numbers = candidates[cell]; numbers != 0; numbers &= numbers-1, var++ ){
+            if( !is_true[var] ){
+                continue;
+            }
+            uint32_t number = lowest_bit(numbers) + 1;
+            if( puzzle[row][col] != 0 ){
+                std::cerr << "decode error: (" << row << ", " << col << ") = " << number << std::endl;
+                continue;
+            }
+            puzzle[row][col] = number;
+        }
+    }
+}
+
+template class FixedSudokuSolver<3>;
+template class FixedSudokuSolver<4>;
+template class FixedSudokuSolver<5>;
+template class FixedSudokuSolver<6>;
@@ -0,0 +1,85 @@
+/**
+ * @file sudoku_solver_fixed.h
+ * @brief SudokuSolver specialised on the box size at compile time, for the sizes we actually use (3 to 6).
+ *
+ * same interface as SudokuSolver, but std::array storage, constexpr tables of the cells of each
+ * unit (row, column, block) and of the units of each cell, and one bitmask of numbers per unit and
+ * per cell in place of vector_2d<bool>. main() picks the solver once the first line of a puzzle
+ * gave its size; SudokuSolver remains for the other sizes. both make the same CNF, variables and
+ * clauses in the same order: the groups go through the same gen_exactly_one() (clause_sink.h).
+ *
+ * cells and units are 0-based here: cell = (row-1) * N*N + (col-1), units are the N*N rows, then
+ * the columns, then the blocks. numbers stay 1-based, number n is bit n-1 of a mask.
+ */
+
+#ifndef __SUDOKU_SOLVER_FIXED_H__
+#define __SUDOKU_SOLVER_FIXED_H__
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "clause_sink.h"
+#include "sat_backend.h"
+#include "utils.h"
+
+template <uint32_t N>
+class FixedSudokuSolver {
+public:
+    static constexpr uint32_t size = N;
+    static constexpr uint32_t SIZE_SQUARE = N*N;
+    static constexpr uint32_t CELLS = SIZE_SQUARE * SIZE_SQUARE;
+    static constexpr uint32_t UNITS = 3 * SIZE_SQUARE;
+
+    /** @brief a set of numbers, number n is bit n-1 */
+    using NumberMask = typename std::conditional<(SIZE_SQUARE <= 32), uint32_t, uint64_t>::type;
+
+    /** @brief 1-based, as SudokuSolver::puzzle; decode() fills in the solution */
+    vector_2d<uint32_t> puzzle;
+
+    FixedSudokuSolver(const vector_2d<uint32_t>& puzzle);
+
+    static constexpr uint32_t size_square() { return SIZE_SQUARE; }
+
+    /** @brief numbers used in each unit, candidates and variables of each empty cell */
+    void prepare();
+    /** @brief push every clause into sink in the same order each time, on several threads for N >= PARALLEL_MIN_SIZE */
+    void gen_clauses(ClauseSink& sink);
+    /** @brief task < N*N: the cells of row task (0-based), else unit task - N*N */
+    void gen_task(uint32_t task, ClauseSink& sink) const;
+    uint32_t threads = 1;
+
+    uint32_t variable_count() const { return var_num; }
+    /** @brief most constrained cell first, candidates true first, as SudokuSolver::gen_hints() */
+    void gen_hints(SatHints& hints) const;
+    /** @brief most constrained cells in all ways, as SudokuSolver::gen_cubes() */
+    void gen_cubes(uint32_t count, std::vector<std::vector<int32_t>>& cubes) const;
+
+    void decode(std::vector<int32_t> sat_output_num);
+
+    /** @brief bytes held: the arrays below and the puzzle */
+    size_t memory_bytes() const { return sizeof(*this) + vector_bytes(puzzle); }
+    /** @brief no Encoder: variables are numbered in the arrays below */
+    size_t encoder_bytes() const { return 0; }
+
+private:
+    std::array<uint8_t, CELLS> grid;            // number of each cell, 0 for empty
+    std::array<NumberMask, UNITS> unit_used;    // numbers given in each unit
+    std::array<NumberMask, CELLS> candidates;   // numbers an empty cell can take (none for given cells)
+    std::array<uint32_t, CELLS> var_base;       // variable of the smallest candidate, the others follow it
+    std::array<uint32_t, SIZE_SQUARE + UNITS> task_aux;    // first auxiliary variable of each task (ladder encoding)
+    uint32_t var_num = 0;                       // candidates, then auxiliary variables
+    bool givens_conflict = false;               // a number twice in a unit or out of range: no solution
+
+    /** @brief variable of number (1-based) in cell, number must be a candidate of cell */
+    int32_t variable(uint32_t cell, uint32_t number) const;
+};
+
+extern template class FixedSudokuSolver<3>;
+extern template class FixedSudokuSolver<4>;
+extern template class FixedSudokuSolver<5>;
+extern template class FixedSudokuSolver<6>;
+
+#endif /* end of include guard: __SUDOKU_SOLVER_FIXED_H__ */
@@ -0,0 +1,324 @@
+/**
+ * @file sudoku_verifier.cpp
+ * @brief check solutions: each row, column and block holds every number once, and the givens are kept.
+ */
+
+#include "sudoku_verifier.h"
+#include "compressed_stream.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+/** @brief faults listed per puzzle, the rest is only counted */
+const uint32_t MAX_FAULTS = 8;
+
+/** @brief a whole file, mapped read-only; a gzip file is inflated into memory instead */
+class MappedFile {
+public:
+    ~MappedFile(){
+        if( data != nullptr ){
+            munmap(const_cast<char*>(data), length);
+        }
+    }
+
+    bool open(const std::string& name){
+        int fd = ::open(name.c_str(), O_RDONLY);
+        struct stat st;
+        if( fd == -1 || fstat(fd, &st) != 0 ){
+            if( fd != -1 ){
+                close(fd);
+            }
+            return false;
+        }
+        length = st.st_size;
+        if( length > 0 ){
+            void* map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if( map != MAP_FAILED ){
+                data = static_cast<const char*>(map);
+                madvise(map, length, MADV_SEQUENTIAL);
+            }
+        }
+        close(fd);
+        if( data != nullptr && length >= 2 && static_cast<unsigned char>(data[0]) == 0x1f && static_cast<unsigned char>(data[1]) == 0x8b ){
+            bool inflated = gunzip(data, length, text);
+            munmap(const_cast<char*>(data), length);
+            data = nullptr;
+            return inflated;
+        }
+        return length == 0 || data != nullptr;
+    }
+
+    const char* begin() const { return data != nullptr ? data : text.data(); }
+    const char* end() const { return data != nullptr ? data + length : text.data() + text.size(); }
+    size_t size() const { return data != nullptr ? length : text.size(); }
+
+private:
+    const char* data = nullptr;
+    size_t length = 0;
+    std::string text;           // the inflated gzip file
+};
+
+/** @brief grids (or answer words) one after the other, lines as in read_puzzle() of main.cpp */
+class GridReader {
+public:
+    GridReader(const char* begin, const char* end) : p(begin), end(end) {}
+
+    /**
+     * @brief the next grid, row by row, size_square is the count of numbers on its first line; or, if
+     * allow_words, the next line with text but no digits as word. false at the end.
+     */
+    bool next(std::vector<uint32_t>& numbers, uint32_t& size_square, std::string& word, bool allow_words){
+        numbers.clear();
+        word.clear();
+        const char* line;
+        const char* line_end;
+        // skip lines without digits
+        while( true ){
+            if( !next_line(line, line_end) ){
+                return false;
+            }
+            if( std::find_if(line, line_end, is_digit) != line_end ){
+                break;
+            }
+            const char* text = std::find_if(line, line_end, [](char c){ return !std::isspace(static_cast<unsigned char>(c)); });
+            if( allow_words && text != line_end ){
+                const char* text_end = line_end;
+                while( std::isspace(static_cast<unsigned char>(text_end[-1])) ){
+                    text_end--;
+                }
+                word.assign(text, text_end);
+                return true;
+            }
+        }
+
+        size_square = parse_numbers(line, line_end, numbers);
+        uint32_t size = static_cast<uint32_t>( std::lround(std::sqrt(static_cast<double>(size_square))) );
+        bool malformed = size * size != size_square;
+        for( uint32_t row = 1; row < size_square && !malformed && next_line(line, line_end); row++ ){
+            uint32_t count = parse_numbers(line, line_end, numbers);
+            if( count == 0 ){
+                return true;    // the grid ended early, at the blank line before the next one
+            }
+            malformed = count != size_square;
+        }
+        // as read_puzzle() does, the rest of a malformed grid goes with it, up to the blank line after it
+        while( malformed && next_line(line, line_end) && std::find_if(line, line_end, is_digit) != line_end ){
+        }
+        return true;
+    }
+
+private:
+    const char* p;
+    const char* end;
+
+    static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+    bool next_line(const char*& line, const char*& line_end){
+        if( p >= end ){
+            return false;
+        }
+        line = p;
+        line_end = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if( line_end == nullptr ){
+            line_end = end;
+        }
+        p = line_end + 1;
+        return true;
+    }
+
+    static uint32_t parse_numbers(const char* line, const char* line_end, std::vector<uint32_t>& numbers){
+        uint32_t count = 0;
+        for( const char* q = line; q < line_end; ){
+            if( !is_digit(*q) ){
+                q++;
+                continue;
+            }
+            uint32_t number = 0;
+            for( ; q < line_end && is_digit(*q); q++ ){
+                number = number * 10 + (*q - '0');
+            }
+            numbers.push_back(number);
+            count++;
+        }
+        return count;
+    }
+};
+
+} // namespace
+
+SudokuVerifier::SudokuVerifier(uint32_t size) : size(size), size_square(size*size), words((size*size + 63) / 64) {
+    masks.resize(3 * size_square * words);
+    full.assign(words, 0);
+    for( uint32_t bit = 0; bit < size_square; bit++ ){
+        full[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+    for( uint32_t line = 0; line < size_square; line++ ){
+        block_row.push_back((line / size) * size);
+        block_col.push_back(line / size);
+    }
+}
+
+bool SudokuVerifier::verify(const uint32_t* puzzle, const uint32_t* solution, std::string* faults){
+    std::fill(masks.begin(), masks.end(), 0);
+    uint64_t* row_masks = masks.data();
+    uint64_t* col_masks = row_masks + size_square * words;
+    uint64_t* block_masks = col_masks + size_square * words;
+
+    uint32_t fault_count = 0;
+    auto fault = [&](const std::string& what){
+        if( faults != nullptr && fault_count < MAX_FAULTS ){
+            *faults += (fault_count > 0 ? ", " : "") + what;
+        }
+        else if( faults != nullptr && fault_count == MAX_FAULTS ){
+            *faults += ", ...";
+        }
+        fault_count++;
+    };
+    auto cell_fault = [&](uint32_t row, uint32_t col, uint32_t given, uint32_t number){
+        std::string cell = "(" + std::to_string(row+1) + ", " + std::to_string(col+1) + ") = ";
+        if( number - 1 >= size_square ){
+            fault(cell + std::to_string(number));
+        }
+        else{
+            fault("given " + cell + std::to_string(given) + " changed to " + std::to_string(number));
+        }
+    };
+
+    // 1. cells: range and givens, then their bit into the masks of their units (one word: up to 64 numbers)
+    for( uint32_t row = 0; row < size_square; row++ ){
+        const uint32_t* puzzle_row = puzzle + row * size_square;
+        const uint32_t* solution_row = solution + row * size_square;
+        uint64_t* block_row_masks = block_masks + block_row[row] * words;
+
+        for( uint32_t col = 0; col < size_square; col++ ){
+            const uint32_t number = solution_row[col];
+            if( number - 1 >= size_square || (puzzle_row[col] != 0 && puzzle_row[col] != number) ){
+                cell_fault(row, col, puzzle_row[col], number);
+                if( number - 1 >= size_square ){
+                    continue;
+                }
+            }
+            if( words == 1 ){
+                const uint64_t bit = uint64_t(1) << (number-1);
+                row_masks[row] |= bit;
+                col_masks[col] |= bit;
+                block_row_masks[block_col[col]] |= bit;
+            }
+            else{
+                const uint32_t word = (number-1) / 64;
+                const uint64_t bit = uint64_t(1) << ((number-1) % 64);
+                row_masks[row * words + word] |= bit;
+                col_masks[col * words + word] |= bit;
+                block_row_masks[block_col[col] * words + word] |= bit;
+            }
+        }
+    }
+
+    // 2. units: every number once, size_square cells in range, so a full mask
+    const char* unit_names[] = { "row", "col", "block" };
+    for( uint32_t unit = 0; unit < 3 * size_square; unit++ ){
+        if( !std::equal(full.begin(), full.end(), masks.begin() + unit * words) ){
+            fault(std::string(unit_names[unit / size_square]) + " " + std::to_string(unit % size_square + 1));
+        }
+    }
+    return fault_count == 0;
+}
+
+bool SudokuVerifier::verify(const vector_2d<uint32_t>& puzzle, const vector_2d<uint32_t>& solution, std::string* faults){
+    flat_puzzle.clear();
+    flat_solution.clear();
+    for( uint32_t row = 1; row <= size_square; row++ ){
+        flat_puzzle.insert(flat_puzzle.end(), puzzle[row].begin()+1, puzzle[row].end());
+        flat_solution.insert(flat_solution.end(), solution[row].begin()+1, solution[row].end());
+    }
+    if( flat_puzzle.size() != size_square * size_square || flat_solution.size() != size_square * size_square ){
+        if( faults != nullptr ){
+            *faults += "malformed grid";
+        }
+        return false;
+    }
+    return verify(flat_puzzle.data(), flat_solution.data(), faults);
+}
+
+int verify_batch(const std::string& puzzle_name, const std::string& answer_name, std::ostream& report){
+    auto start = std::chrono::steady_clock::now();
+
+    MappedFile puzzle_file, answer_file;
+    if( !puzzle_file.open(puzzle_name) ){
+        std::cerr << "input file error" << std::endl;
+        return 1;
+    }
+    if( !answer_file.open(answer_name) ){
+        std::cerr << "output file error" << std::endl;
+        return 1;
+    }
+    GridReader puzzles(puzzle_file.begin(), puzzle_file.end());
+    GridReader answers(answer_file.begin(), answer_file.end());
+
+    std::vector<uint32_t> puzzle, solution;
+    uint32_t puzzle_size_square, solution_size_square;
+    std::string word;
+    std::vector<SudokuVerifier> verifiers;      // one per box size met so far
+    uint64_t puzzle_count = 0, valid = 0, invalid = 0, unsolved = 0;
+
+    while( puzzles.next(puzzle, puzzle_size_square, word, false) ){
+        puzzle_count++;
+        auto invalid_answer = [&](const std::string& why){
+            report << "puzzle " << puzzle_count << ": " << why << std::endl;
+            invalid++;
+        };
+
+        if( !answers.next(solution, solution_size_square, word, true) ){
+            invalid_answer("no answer");
+            continue;
+        }
+        if( !word.empty() ){
+            unsolved++;     // NO, TIMEOUT, ERROR: nothing to check
+            continue;
+        }
+
+        uint32_t size = static_cast<uint32_t>( std::lround(std::sqrt(static_cast<double>(puzzle_size_square))) );
+        if( size * size != puzzle_size_square || puzzle.size() != puzzle_size_square * puzzle_size_square ){
+            invalid_answer("malformed puzzle");
+            continue;
+        }
+        if( solution_size_square != puzzle_size_square || solution.size() != puzzle.size() ){
+            invalid_answer("malformed solution");
+            continue;
+        }
+
+        auto verifier = std::find_if(verifiers.begin(), verifiers.end(), [&](const SudokuVerifier& v){ return v.box_size() == size; });
+        if( verifier == verifiers.end() ){
+            verifiers.emplace_back(size);
+            verifier = verifiers.end() - 1;
+        }
+        std::string faults;
+        if( verifier->verify(puzzle.data(), solution.data(), &faults) ){
+            valid++;
+        }
+        else{
+            invalid_answer("invalid: " + faults);
+        }
+    }
+    if( answers.next(solution, solution_size_square, word, true) ){
+        report << "more answers than puzzles" << std::endl;
+        invalid++;
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    double megabytes = (puzzle_file.size() + answer_file.size()) / 1e6;
+    report << "verify: " << puzzle_count << " puzzles, " << valid << " valid, " << invalid << " invalid, "
+           << unsolved << " unsolved (" << megabytes / std::max(elapsed.count(), 1e-9) << " MB/s)" << std::endl;
+    return invalid == 0 ? 0 : 2;
+}
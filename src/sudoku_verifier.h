@@ -0,0 +1,52 @@
+/**
+ * @file sudoku_verifier.h
+ * @brief check solutions: each row, column and block holds every number once, and the givens are kept.
+ *
+ * each unit ORs the bits of its numbers into a mask, compared with the full mask at the end; numbers
+ * out of range are caught before, so a full mask means a permutation. --verify checks whole batch
+ * files (mapped, parsed in place), --check every solution before it is written.
+ */
+
+#ifndef __SUDOKU_VERIFIER_H__
+#define __SUDOKU_VERIFIER_H__
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "utils.h"
+
+class SudokuVerifier {
+public:
+    /** @brief for boards with boxes of size x size cells */
+    explicit SudokuVerifier(uint32_t size);
+
+    uint32_t box_size() const { return size; }
+
+    /**
+     * @brief true if solution solves puzzle, both row by row (size^4 numbers, 0 for empty in puzzle).
+     * if not and faults is set, it gets the first few reasons.
+     */
+    bool verify(const uint32_t* puzzle, const uint32_t* solution, std::string* faults = nullptr);
+    /** @brief the same for the 1-based grids of main() */
+    bool verify(const vector_2d<uint32_t>& puzzle, const vector_2d<uint32_t>& solution, std::string* faults = nullptr);
+
+private:
+    uint32_t size;
+    uint32_t size_square;
+    uint32_t words;                     // 64-bit words per mask
+    std::vector<uint64_t> masks;        // rows, then columns, then blocks
+    std::vector<uint64_t> full;
+    std::vector<uint32_t> block_row, block_col;     // [row] => its first block, [col] => block offset in a band
+    std::vector<uint32_t> flat_puzzle, flat_solution;
+};
+
+/**
+ * @brief check each answer of answer_name (solution, or a word: NO, TIMEOUT, ERROR) against its puzzle in
+ * puzzle_name, faults and a summary go to report. returns 0 if all solutions are valid, 2 if not, 1 on
+ * a file error.
+ */
+int verify_batch(const std::string& puzzle_name, const std::string& answer_name, std::ostream& report);
+
+#endif /* end of include guard: __SUDOKU_VERIFIER_H__ */
@@ -5,5 +5,16 @@
 template <class T> using vector_2d = std::vector< std::vector<T> >; 
 template <class T> using vector_3d = std::vector< vector_2d<T> >;
 
+/* bytes allocated by a vector (its capacity), and by the inner vectors of a vector_2d */
+template <class T> size_t vector_bytes(const std::vector<T>& v){ return v.capacity() * sizeof(T); }
+inline size_t vector_bytes(const std::vector<bool>& v){ return v.capacity() / 8; }
+template <class T> size_t vector_bytes(const vector_2d<T>& v){
+    size_t bytes = v.capacity() * sizeof(std::vector<T>);
+    for( const auto& inner : v ){
+        bytes += vector_bytes(inner);
+    }
+    return bytes;
+}
+
 #endif /* end of include guard: __UTILS_H__ */
 
@@ -0,0 +1,90 @@
+#!/bin/sh
+# make check: --mem against the memory model of src/sudoku_solver.h, board by board of its table.
+#
+# each board (a solved grid, about half the cells given) is solved up to the first conflict with
+# --mem, then
+#   - literals loaded, peak RSS at the end of the encode stage and at the end must not be more
+#     than 20% over the literals, encoding and in-process columns of the table;
+#   - bytes per literal loaded into MiniSat, and while eliminating, not 20% over the model;
+#   - the Encoder, exactly S^2 * (8 * ceil(S/64) + 4) + 4 bytes; boards up to 36x36 must go to
+#     FixedSudokuSolver, which has none.
+#
+# usage: test/check_memory.sh [sudoku_solver]
+
+SOLVER=${1:-./bin/sudoku_solver}
+MODEL=$(dirname "$0")/../src/sudoku_solver.h
+DIR=$(mktemp -d /tmp/check_memory.XXXXXX) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+
+# board of box size n: a solved grid, a cell given if a hash of its row and column says so
+board(){
+    awk -v n="$1" 'BEGIN{
+        S = n*n
+        for( r = 0; r < S; r++ ){
+            line = ""
+            for( c = 0; c < S; c++ ){
+                v = (n*(r%n) + int(r/n) + c) % S + 1
+                if( (r*7919 + c*104729 + r*c*31) % 1000 >= 500 ){ v = 0 }
+                line = line (c ? " " : "") v
+            }
+            print line
+        }
+    }'
+}
+
+# "S literals encoding in-process" per row of the table, literals in units
+table=$(awk '/^ \*   [0-9]+x[0-9]+ / {
+    split($2, size, "x")
+    literals = $7 * ($8 == "M" ? 1000000 : 1000)
+    print size[1], literals, $9, $11
+}' "$MODEL")
+loaded_model=$(sed -n 's/.*about \([0-9]*\) bytes per literal loaded.*/\1/p' "$MODEL")
+eliminate_model=$(sed -n 's/.*and about \([0-9]*\) more per literal while.*/\1/p' "$MODEL")
+if [ -z "$table" ] || [ -z "$loaded_model" ] || [ -z "$eliminate_model" ]; then
+    echo "FAIL  no memory model in $MODEL"
+    exit 1
+fi
+
+failed=0
+echo "$table" | {
+while read size literals encoding inprocess; do
+    n=$(awk -v s="$size" 'BEGIN{ print int(sqrt(s) + 0.5) }')
+    board "$n" > "$DIR/board.txt"
+    "$SOLVER" --mem --conflicts=1 --retries=0 "$DIR/board.txt" "$DIR/answer.txt" > "$DIR/mem.txt" 2> /dev/null
+    encoder=$(sed -n 's/^mem encoder candidates: \([0-9]*\) bytes.*/\1/p' "$DIR/mem.txt")
+    if [ "$n" -le 6 ]; then
+        expected=""
+    else
+        expected=$((size * size * (8 * ((size + 63) / 64) + 4) + 4))
+    fi
+
+    report=$(awk -v literals="$literals" -v encoding="$encoding" -v inprocess="$inprocess" \
+                 -v loaded_model="$loaded_model" -v eliminate_model="$eliminate_model" '
+        function check(what, got, model, format){
+            if( got > 1.2 * model ){ bad = bad sprintf(" %s " format " > " format " * 1.2;", what, got, model) }
+            else{ good = good sprintf(" %s " format ";", what, got) }
+        }
+        /^mem stage encode /   { rss_encode = $7 }
+        /^mem stage write /    { rss_end = $7 }
+        /^mem minisat preprocess:/ { eliminate = $4 * 1048576 }
+        /^mem minisat loaded /  { loaded = $5; per_literal = $7 }
+        END{
+            if( loaded == 0 ){ print "FAIL no --mem output"; exit }
+            check("literals", loaded, literals, "%d")
+            check("encoding MB", rss_encode, encoding, "%.1f")
+            check("in-process MB", rss_end, inprocess, "%.1f")
+            check("bytes per literal", per_literal, loaded_model, "%.1f")
+            check("eliminating", eliminate / loaded, eliminate_model, "%.1f")
+            print (bad == "" ? "ok  " good : "FAIL" bad)
+        }' "$DIR/mem.txt")
+
+    if [ "$encoder" != "$expected" ]; then
+        report="FAIL encoder ${encoder:-none} bytes, model ${expected:-none}; $report"
+    fi
+    case "$report" in
+        FAIL*) failed=1 ;;
+    esac
+    echo "${size}x${size}: $report"
+done
+exit $failed
+}